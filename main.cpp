@@ -6,304 +6,3769 @@
 #include <algorithm>
 #include <cassert>
 #include <numeric>
+#include <cmath>
 #include <functional>
 #include <unordered_map>
+#include <map>
+#include <tuple>
+#include <cctype>
+#include <array>
+#include <string_view>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <cstring>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <filesystem>
+#include <stdexcept>
+#include <optional>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+// Global operator new is replaced so that the benchmark can report how many heap
+// allocations a sort performs and how much memory it holds at its peak. Every block
+// carries a header in front of the returned pointer with its size, or 0 if it was
+// allocated while counting was off; only then do new and delete touch the shared
+// counters. All plain, array and nothrow forms go through the same pair, so any
+// delete can read the header. The align_val_t forms keep the library versions,
+// which neither write nor read a header, and are not counted.
+struct AllocCounter {
+    static inline std::atomic<bool> enabled{false};
+    static inline std::atomic<std::size_t> count{0};
+    static inline std::atomic<std::size_t> bytes{0};
+    static inline std::atomic<std::size_t> live{0};
+    static inline std::atomic<std::size_t> peak{0};
+
+    static constexpr std::size_t header = alignof(std::max_align_t);
+
+    static void resetPeak() { peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+};
+
+// Sizes the header would wrap around fail outright; otherwise the new-handler gets
+// its chance to free memory after every failed malloc, as the standard requires.
+void* operator new(std::size_t size) {
+    if (size > SIZE_MAX - AllocCounter::header) throw std::bad_alloc();
+    char* block;
+    while (!(block = static_cast<char*>(std::malloc(size + AllocCounter::header)))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+    bool counted = AllocCounter::enabled.load(std::memory_order_relaxed) && size > 0;
+    *reinterpret_cast<std::size_t*>(block) = counted ? size : 0;
+    if (counted) {
+        AllocCounter::count.fetch_add(1, std::memory_order_relaxed);
+        AllocCounter::bytes.fetch_add(size, std::memory_order_relaxed);
+        std::size_t now = AllocCounter::live.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = AllocCounter::peak.load(std::memory_order_relaxed);
+        while (now > peak && !AllocCounter::peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+    }
+    return block + AllocCounter::header;
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return ::operator new(size, tag); }
+
+// Not inlined: GCC would otherwise pair the header arithmetic with operator new
+// at call sites and warn about out-of-bounds access and mismatched free().
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* block = static_cast<char*>(p) - AllocCounter::header;
+    if (std::size_t size = *reinterpret_cast<std::size_t*>(block))
+        AllocCounter::live.fetch_sub(size, std::memory_order_relaxed);
+    std::free(block);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete(void* p, const std::nothrow_t&) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete[](void* p, const std::nothrow_t&) noexcept { ::operator delete(p); }
+
+struct PrintableChars {
+    static constexpr std::string_view chars =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789"
+        "!@#%:;^&*()-.";
+};
+
+// Maps the characters listed in Chars::chars to radix digits 0..R-1 through a
+// 256-entry table built at compile time. Digits follow byte order, so radix passes
+// agree with std::string comparison. Characters outside the list get -1 and sort
+// together with the end of the string; ByteAlphabet covers arbitrary keys.
+template<typename Chars>
+struct Alphabet {
+    static constexpr int R = (int)Chars::chars.size();
+
+    static constexpr std::array<int, 256> index = [] {
+        std::array<int, 256> table{};
+        for (auto& v : table) v = -1;
+        for (char c : Chars::chars) table[(unsigned char)c] = 0;
+        int next = 0;
+        for (auto& v : table)
+            if (v == 0) v = next++;
+        return table;
+    }();
+
+    static constexpr int toIndex(char c) { return index[(unsigned char)c]; }
+
+private:
+    static constexpr bool distinct() {
+        int used = 0;
+        for (int v : index) used += v >= 0;
+        return used == R;
+    }
+    static_assert(distinct(), "alphabet characters must be distinct");
+};
+
+struct ByteAlphabet {
+    static constexpr int R = 256;
+    static constexpr int toIndex(char c) { return (unsigned char)c; }
+};
+
+using KeyAlphabet = Alphabet<PrintableChars>;
+
+// Small counter-based generator; seeding it with a hash of a key's coordinates gives
+// every key its own independent stream.
+struct SplitMix64 {
+    std::uint64_t state;
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, bound) by multiply-shift; the bias is below 2^-24 for the bounds used here.
+    std::uint32_t below(std::uint32_t bound) { return (std::uint32_t)(((next() >> 32) * bound) >> 32); }
+};
+
+// Produces samples of any size on demand. Key i of an n-key sample is a function of
+// (seed, kind, i) alone for Random and SharedPrefix, and of (seed, n, i) for the
+// ordered kinds, whose keys are laid out in order rather than sorted: key j of the
+// ascending sequence starts with j * R^w / n written as w alphabet digits, where
+// R^w >= n, followed by a random tail. Reverse and AlmostSorted are permutations of
+// that sequence. Nothing is precomputed beyond the sixteen shared-prefix paths, so
+// any range of keys can be generated independently, in chunks and in parallel.
 class StringGenerator {
 public:
-    enum class Kind { Random, Reverse, AlmostSorted };
+    enum class Kind { Random, Reverse, AlmostSorted, SharedPrefix };
+
+    StringGenerator(unsigned seed = std::random_device{}())
+        : seed(seed),
+          alphabet(PrintableChars::chars)
+    {
+        std::sort(alphabet.begin(), alphabet.end());
+        SplitMix64 rng{ keySeed(pathsStream, 0) };
+        std::string root = randomString(rng, 20);
+        for (int i = 0; i < 16; ++i) paths.push_back(root + randomString(rng, rng.below(41)));
+    }
+
+    // Threads used by getSample and forEachChunk; 0 means one per hardware thread.
+    void setThreads(std::size_t n) {
+        threads = n ? n : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::string> getSample(std::size_t size, Kind kind) const {
+        std::vector<std::string> res(size);
+        std::size_t parts = std::min(threads, (size + parallelGrain - 1) / parallelGrain);
+        runParallel(parts, [&](std::size_t t) {
+            std::size_t lo = size * t / parts, hi = size * (t + 1) / parts;
+            fill(kind, size, lo, hi, res.data() + lo);
+        });
+        return res;
+    }
+
+    // Passes the n-key sample to sink in order, as vectors of at most chunkSize keys.
+    // One chunk per thread is generated at a time, so memory does not grow with n.
+    template<typename Sink>
+    void forEachChunk(Kind kind, std::size_t n, std::size_t chunkSize, Sink sink) const {
+        assert(chunkSize > 0);
+        std::vector<std::vector<std::string>> batch(threads);
+        for (std::size_t from = 0; from < n; from += threads * chunkSize) {
+            std::size_t parts = std::min(threads, (n - from + chunkSize - 1) / chunkSize);
+            runParallel(parts, [&](std::size_t t) {
+                std::size_t lo = from + t * chunkSize, hi = std::min(n, lo + chunkSize);
+                batch[t].resize(hi - lo);
+                fill(kind, n, lo, hi, batch[t].data());
+            });
+            for (std::size_t t = 0; t < parts; ++t) sink(batch[t]);
+        }
+    }
+
+    // Keys [lo, hi) of the n-key sample of kind, written to out[0 .. hi - lo).
+    void fill(Kind kind, std::size_t n, std::size_t lo, std::size_t hi, std::string* out) const {
+        if (kind == Kind::Random || kind == Kind::SharedPrefix) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                SplitMix64 rng{ keySeed((std::uint64_t)kind, i) };
+                out[i - lo] = kind == Kind::Random ? randomString(rng, 10 + rng.below(191))
+                                                   : paths[rng.below(16)] + randomString(rng, 1 + rng.below(30));
+            }
+            return;
+        }
+        // Every product below stays under n * alphabet.size().
+        assert(n <= UINT64_MAX / alphabet.size());
+        std::size_t width = 1;
+        for (std::uint64_t span = alphabet.size(); span < n; span *= alphabet.size()) ++width;
+        for (std::size_t i = lo; i < hi; ++i) {
+            std::size_t j = i;
+            if (kind == Kind::Reverse) j = n - 1 - i;
+            else if (i % 10 == 0 && i + 1 < n) j = i + 1;
+            else if (i % 10 == 1) j = i - 1;
+            out[i - lo] = orderedKey(n, j, width);
+        }
+    }
+
+private:
+    static constexpr std::uint64_t pathsStream = 0xff;
+    static constexpr std::size_t parallelGrain = 1 << 14;
+
+    unsigned seed;
+    std::string alphabet;
+    std::vector<std::string> paths;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::uint64_t keySeed(std::uint64_t stream, std::uint64_t index) const {
+        SplitMix64 h{ ((std::uint64_t)seed << 32 | stream) * 0xd1342543de82ef95 ^ index };
+        return h.next();
+    }
+
+    std::string randomString(SplitMix64& rng, std::size_t len) const {
+        std::string s(len, ' ');
+        for (auto& c : s) c = alphabet[rng.below((std::uint32_t)alphabet.size())];
+        return s;
+    }
+
+    // Key j of the ascending n-key sequence; the first width characters are the
+    // base-R digits of j * R^width / n (R = alphabet size), which increase strictly
+    // with j, so the random tail never affects the order. The digits come from a long
+    // division of j / n, one per step, so no intermediate exceeds n * R.
+    std::string orderedKey(std::size_t n, std::size_t j, std::size_t width) const {
+        SplitMix64 rng{ keySeed((std::uint64_t)Kind::Reverse, j) };
+        std::string s = randomString(rng, 10 + rng.below(191));
+        std::uint64_t rem = j;
+        for (std::size_t d = 0; d < width; ++d) {
+            rem *= alphabet.size();
+            s[d] = alphabet[rem / n];
+            rem %= n;
+        }
+        return s;
+    }
+
+    template<typename F>
+    void runParallel(std::size_t parts, F f) const {
+        std::vector<std::thread> pool;
+        for (std::size_t t = 1; t < parts; ++t) pool.emplace_back(f, t);
+        if (parts > 0) f(0);
+        for (auto& th : pool) th.join();
+    }
+};
+
+// 16-byte handle to a key stored elsewhere. The sort cores permute handles rather
+// than std::string objects; idx is the key's position in the source container, which
+// limits a sort to 2^32 keys of at most 2^32 - 1 bytes each.
+struct KeyHandle {
+    const char* ptr;
+    std::uint32_t len;
+    std::uint32_t idx;
+
+    std::size_t size() const { return len; }
+    const char* data() const { return ptr; }
+    char operator[](std::size_t i) const { return ptr[i]; }
+    std::string_view view() const { return { ptr, len }; }
+
+    friend bool operator<(const KeyHandle& a, const KeyHandle& b) { return a.view() < b.view(); }
+    friend bool operator>(const KeyHandle& a, const KeyHandle& b) { return a.view() > b.view(); }
+};
+
+// A key together with its bytes [depth, depth + 8) packed big-endian and zero-padded,
+// so that word order is byte order. Comparisons and radix digits inside that window
+// come from the word without touching the key's characters.
+template<typename Key>
+struct CachedKey {
+    std::uint64_t word;
+    Key key;
+};
+
+// Splitters of one sample sort step stored as an implicit binary search tree
+// (Eytzinger layout, root at 1), small enough to stay in L1. classify() descends
+// with one data-dependent index update per level and no branches on the key, and
+// returns 2b for keys strictly between splitters b - 1 and b, 2b + 1 for keys equal
+// to splitter b.
+struct SplitterTree {
+    static constexpr std::size_t maxLevels = 8;
+
+    std::size_t levels = 0;
+    std::size_t leaves = 1;
+    std::array<std::uint64_t, (1 << maxLevels)> tree{};
+    std::array<std::uint64_t, (1 << maxLevels)> sorted{};
+
+    // sorted[0 .. 2^levels - 1) must be filled in ascending order.
+    void build(std::size_t levelCount) {
+        levels = levelCount;
+        leaves = std::size_t(1) << levels;
+        std::size_t k = 0;
+        fill(1, k);
+    }
+
+    std::size_t buckets() const { return 2 * leaves - 1; }
+
+    std::size_t classify(std::uint64_t w) const {
+        std::size_t i = 1;
+        for (std::size_t l = 0; l < levels; ++l)
+            i = 2 * i + (w > tree[i]);
+        std::size_t b = i - leaves;
+        return 2 * b + (b < leaves - 1 && w == sorted[b]);
+    }
+
+private:
+    void fill(std::size_t i, std::size_t& k) {
+        if (i >= leaves) return;
+        fill(2 * i, k);
+        tree[i] = sorted[k++];
+        fill(2 * i + 1, k);
+    }
+};
+
+// Kernels returning the first index in [0, n) at which a and b differ, or n. The
+// portable one compares 8-byte words; the x86 ones compare 16, 32 or 64 bytes per
+// step and locate the mismatch with movemask and a trailing zero count.
+using MismatchFn = std::size_t (*)(const char* a, const char* b, std::size_t n);
+
+inline std::size_t mismatchWords(const char* a, const char* b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        if (x != y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return i + __builtin_ctzll(x ^ y) / 8;
+#else
+            return i + __builtin_clzll(x ^ y) / 8;
+#endif
+        }
+    }
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+inline std::size_t mismatchSse2(const char* a, const char* b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        unsigned diff = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+        if (diff) return i + __builtin_ctz(diff);
+    }
+    return i + mismatchWords(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t mismatchAvx2(const char* a, const char* b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        unsigned diff = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (diff) return i + __builtin_ctz(diff);
+    }
+    return i + mismatchSse2(a + i, b + i, n - i);
+}
+
+// The tail is read with a masked load, which cannot fault past the end of a key.
+__attribute__((target("avx512f,avx512bw")))
+inline std::size_t mismatchAvx512(const char* a, const char* b, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        std::uint64_t diff = _mm512_cmpneq_epi8_mask(x, y);
+        if (diff) return i + __builtin_ctzll(diff);
+    }
+    if (i == n) return n;
+    __mmask64 tail = (~0ull) >> (64 - (n - i));
+    std::uint64_t diff = _mm512_cmpneq_epi8_mask(_mm512_maskz_loadu_epi8(tail, a + i),
+                                                 _mm512_maskz_loadu_epi8(tail, b + i));
+    return diff ? i + __builtin_ctzll(diff) : n;
+}
+#endif
+
+struct MismatchKernel {
+    const char* name;
+    MismatchFn fn;
+};
+
+// Kernels the running CPU supports, slowest first.
+inline std::vector<MismatchKernel> mismatchKernels() {
+    std::vector<MismatchKernel> kernels{ { "words", mismatchWords } };
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) kernels.push_back({ "sse2", mismatchSse2 });
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({ "avx2", mismatchAvx2 });
+    if (__builtin_cpu_supports("avx512bw")) kernels.push_back({ "avx512", mismatchAvx512 });
+#endif
+    return kernels;
+}
+
+inline const MismatchFn mismatchBytes = mismatchKernels().back().fn;
+
+// Length of the common prefix of a and b, which must already agree on [0, from).
+// The number of characters compared is added to comps. Most calls in the sorts stop
+// at the first character, so it is checked before calling the kernel.
+template<typename Key, typename Counter>
+std::size_t lcpFrom(const Key& a, const Key& b, std::size_t from, Counter& comps) {
+    std::size_t n = std::min(a.size(), b.size());
+    std::size_t i = from;
+    if (i < n && a[i] == b[i]) i += 1 + mismatchBytes(a.data() + i + 1, b.data() + i + 1, n - i - 1);
+    comps += i - from + (i < n);
+    return i;
+}
+
+// Three-way comparison of whole keys by unsigned bytes. The number of characters
+// compared is added to comps.
+template<typename Key, typename Counter>
+int compareKeys(const Key& a, const Key& b, Counter& comps) {
+    std::size_t n = std::min(a.size(), b.size());
+    std::size_t i = mismatchBytes(a.data(), b.data(), n);
+    comps += i + (i < n);
+    if (i < n) return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+    return a.size() < b.size() ? -1 : a.size() > b.size();
+}
+
+// Sorted run held in memory together with its LCP array.
+template<typename Key>
+struct ArrayRunSource {
+    Key* keys;
+    const std::size_t* lcps;    // lcps[i] = lcp(keys[i - 1], keys[i])
+    std::size_t size;
+    std::size_t pos = 0;
+
+    bool empty() const { return pos >= size; }
+    Key& key() { return keys[pos]; }
+    const Key& key() const { return keys[pos]; }
+    std::size_t lcp() const { return lcps[pos]; }
+    void next() { ++pos; }
+};
+
+// Sorted range [first, last) of a forward iterator without stored LCPs. The LCP
+// of each element with its successor is computed as soon as the element becomes
+// current, so the sink may move keys out of the range. Looking ahead needs a
+// second pass over the element, so input iterators are rejected; wrap a stream in
+// StreamRunSource instead.
+template<typename It>
+class IteratorRunSource {
+    static_assert(std::is_base_of_v<std::forward_iterator_tag,
+                                    typename std::iterator_traits<It>::iterator_category>,
+                  "IteratorRunSource needs a forward iterator");
+
+public:
+    IteratorRunSource(It first, It last, std::size_t& comps) : pos(first), last(last), comps(&comps) {
+        nextLcp = lcpToNext();
+    }
+
+    bool empty() const { return pos == last; }
+    decltype(auto) key() const { return *pos; }
+    std::size_t lcp() const { return currentLcp; }
+
+    void next() {
+        ++pos;
+        currentLcp = nextLcp;
+        nextLcp = lcpToNext();
+    }
+
+private:
+    It pos;
+    It last;
+    std::size_t* comps;
+    std::size_t currentLcp = 0;
+    std::size_t nextLcp = 0;
+
+    std::size_t lcpToNext() const {
+        if (pos == last) return 0;
+        It succ = std::next(pos);
+        return succ == last ? 0 : lcpFrom(*pos, *succ, 0, *comps);
+    }
+};
+
+// Sorted newline-delimited keys read from a stream, e.g. a shard output.
+class StreamRunSource {
+public:
+    StreamRunSource(std::istream& in, std::size_t& comps) : in(&in), comps(&comps) {
+        done = !std::getline(in, current);
+    }
+
+    bool empty() const { return done; }
+    const std::string& key() const { return current; }
+    std::size_t lcp() const { return currentLcp; }
+
+    void next() {
+        previous.swap(current);
+        if (!std::getline(*in, current)) {
+            done = true;
+            return;
+        }
+        currentLcp = lcpFrom(previous, current, 0, *comps);
+    }
+
+private:
+    std::istream* in;
+    std::size_t* comps;
+    std::string current;
+    std::string previous;
+    std::size_t currentLcp = 0;
+    bool done;
+};
+
+// Tournament tree over K sorted sources that carries LCPs. A source provides
+// empty(), key(), next() and lcp(), the LCP of key() with the source's previous key.
+// Compared characters are added to comps, of type Counter; matches() counts the
+// matches that had to look at characters, like the tie case of mergeSortLCP.
+// Every internal node keeps the loser of its match together with the LCP between
+// that loser and the match winner. After the winner is popped, its successor only
+// plays the nodes on its path, and characters are compared only when two LCPs
+// relative to the last output tie. Equal keys leave in source order, so the merge
+// is stable. With ArrayRunSource the caller may move top() out before pop().
+template<typename Source, typename Counter = std::size_t>
+class LcpLoserTree {
+public:
+    LcpLoserTree(std::vector<Source> sources, Counter& comps)
+        : sources(std::move(sources)), comps(comps)
+    {
+        leaves = 1;
+        while (leaves < this->sources.size()) leaves *= 2;
+        nodes.resize(leaves);
+        nodes[0] = build(1);
+    }
+
+    bool empty() const { return exhausted(nodes[0].run); }
+    decltype(auto) top() { return sources[nodes[0].run].key(); }
+    // LCP of top() with the key popped before it (0 for the first key).
+    std::size_t topLcp() const { return nodes[0].lcp; }
+    std::size_t matches() const { return played; }
+
+    void pop() {
+        Node cand{ nodes[0].run, 0 };
+        sources[cand.run].next();
+        if (!exhausted(cand.run)) cand.lcp = sources[cand.run].lcp();
+        for (std::size_t i = (cand.run + leaves) / 2; i >= 1; i /= 2)
+            play(cand, nodes[i]);
+        nodes[0] = cand;
+    }
+
+private:
+    struct Node {
+        std::size_t run;
+        std::size_t lcp;
+    };
+
+    std::vector<Source> sources;
+    Counter& comps;
+    std::size_t leaves;
+    std::vector<Node> nodes;
+    std::size_t played = 0;
+
+    bool exhausted(std::size_t r) const { return r >= sources.size() || sources[r].empty(); }
+
+    Node build(std::size_t i) {
+        if (i >= leaves) return { i - leaves, 0 };
+        Node winner = build(2 * i);
+        nodes[i] = build(2 * i + 1);
+        play(winner, nodes[i]);
+        return winner;
+    }
+
+    // Both LCPs are relative to the same earlier key; afterwards cand is the winner
+    // and stored the loser with its LCP to cand.
+    void play(Node& cand, Node& stored) {
+        if (exhausted(stored.run)) return;
+        if (exhausted(cand.run) || cand.lcp < stored.lcp) {
+            std::swap(cand, stored);
+            return;
+        }
+        if (cand.lcp > stored.lcp) return;
+        const auto& a = sources[cand.run].key();
+        const auto& b = sources[stored.run].key();
+        ++played;
+        std::size_t h = lcpFrom(a, b, cand.lcp, comps);
+        bool candFirst;
+        if (h < a.size() && h < b.size()) candFirst = (unsigned char)a[h] < (unsigned char)b[h];
+        else if (a.size() != b.size()) candFirst = a.size() < b.size();
+        else candFirst = cand.run < stored.run;
+        if (!candFirst) std::swap(cand, stored);
+        stored.lcp = h;
+    }
+};
+
+// Merges sorted sources into sink(key, lcp), where lcp is the LCP of key with the
+// key emitted before it. Characters are only inspected past the LCPs the tree
+// already knows, so the cost follows the distinguishing prefixes, not log K full
+// key comparisons. The sink may move the key out of an ArrayRunSource. Returns the
+// number of key comparisons, LcpLoserTree::matches().
+template<typename Source, typename Sink, typename Counter>
+std::size_t lcpMerge(std::vector<Source> sources, Sink sink, Counter& comps) {
+    LcpLoserTree<Source, Counter> tree(std::move(sources), comps);
+    for (; !tree.empty(); tree.pop()) sink(tree.top(), tree.topLcp());
+    return tree.matches();
+}
+
+// Thread pool with one task deque per worker. Workers pop their own deque from the
+// back and steal from the front of the others'; tasks submitted from inside a task
+// go to the submitting worker's deque. Tasks receive the index of the worker that
+// runs them.
+class WorkStealingPool {
+public:
+    using Task = std::function<void(std::size_t)>;
+
+    explicit WorkStealingPool(std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) queues.push_back(std::make_unique<Queue>());
+        for (std::size_t i = 0; i < n; ++i) threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    std::size_t size() const { return queues.size(); }
+
+    void submit(Task task) {
+        std::size_t q = currentPool == this ? currentWorker : next++ % queues.size();
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            queues[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task, including tasks submitted by tasks, is done.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::size_t queued = 0;
+    bool stopping = false;
+    std::atomic<std::size_t> pending{0};
+    std::atomic<std::size_t> next{0};
+
+    static inline thread_local WorkStealingPool* currentPool = nullptr;
+    static inline thread_local std::size_t currentWorker = 0;
+
+    bool take(std::size_t self, Task& task) {
+        for (std::size_t k = 0; k < queues.size(); ++k) {
+            Queue& q = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (k == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t self) {
+        currentPool = this;
+        currentWorker = self;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping) return;
+                --queued;
+            }
+            Task task;
+            while (!take(self, task)) std::this_thread::yield();
+            task(self);
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+// Hardware events of one sort. An event the kernel refuses to count (perf_event_paranoid,
+// no PMU under a hypervisor, a non-Linux build) stays invalid and is left out of the output.
+struct HardwareCounts {
+    enum Event { Cycles, Instructions, L1dMisses, LlcMisses, BranchMisses, DtlbMisses, eventCount };
+    static constexpr const char* names[eventCount] = {
+        "Cycles", "Instructions", "L1d misses", "LLC misses", "Branch misses", "dTLB misses"
+    };
+    std::array<std::uint64_t, eventCount> value{};
+    std::array<bool, eventCount> valid{};
+
+    bool any() const { return std::find(valid.begin(), valid.end(), true) != valid.end(); }
+};
+
+// perf_event_open counters of the calling thread, user space only. Each event is
+// opened on its own so that one the CPU lacks does not take the others down; the
+// kernel multiplexes them if there are too few PMU registers, and stop() scales the
+// raw counts by enabled over running time. Work done on pool threads is not seen.
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds.fill(-1);
+#if defined(__linux__)
+        auto cache = [](std::uint64_t id) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        const std::pair<std::uint32_t, std::uint64_t> events[HardwareCounts::eventCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB) }
+        };
+        for (std::size_t e = 0; e < fds.size(); ++e) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[e].first;
+            attr.config = events[e].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return std::find_if(fds.begin(), fds.end(), [](int fd) { return fd >= 0; }) != fds.end(); }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    HardwareCounts stop() {
+        HardwareCounts hw;
+#if defined(__linux__)
+        for (int fd : fds)
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (std::size_t e = 0; e < fds.size(); ++e) {
+            std::uint64_t buf[3];
+            if (fds[e] < 0 || read(fds[e], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[2] == 0) continue;
+            hw.value[e] = buf[2] == buf[1] ? buf[0] : (std::uint64_t)((double)buf[0] * buf[1] / buf[2]);
+            hw.valid[e] = true;
+        }
+#endif
+        return hw;
+    }
+
+private:
+    std::array<int, HardwareCounts::eventCount> fds;
+};
+
+// Work done by one sort. chars is counted under CountChars and CountDetailed, the
+// other operation counts only under CountDetailed; allocations are always measured.
+struct OpCounts {
+    std::size_t chars = 0;          // key characters read, including bytes loaded into cached words
+    std::size_t baseChars = 0;      // part of chars read by base-case sorts
+    std::size_t compares = 0;       // key, suffix or cached-word comparisons and partition steps
+    std::size_t moves = 0;          // element moves; a swap is three
+    std::size_t allocs = 0;         // heap allocations
+    std::size_t allocBytes = 0;     // bytes requested by them
+    std::size_t maxDepth = 0;       // deepest nesting of recursive calls or radix work-stack entries
+    std::size_t baseCases = 0;      // base-case sort invocations
+};
+
+// Distribution of the measured times of repeated runs, in nanoseconds.
+struct TimingStats {
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double p95 = 0;
+    double stddev = 0;
+    std::size_t samples = 0;
+};
+
+struct SortResult {
+    std::chrono::nanoseconds time;
+    OpCounts ops;
+    std::size_t peakBytes;
+    HardwareCounts hw;
+    TimingStats timing;     // filled by averageRun; time is then the median
+};
+
+enum class SortAlgo { StdQuick, StdMergeLCP, TernaryQuick, MsdRadix, MsdRadixPure, MultikeyQuick, MsdRadixBytes, AmericanFlag,
+                      MsdRadixCached, MultikeyQuickCached, MsdRadixParallel,
+                      MergeLCPParallel, SampleSort, SampleSortParallel,
+                      Burstsort };
+
+// Stands in for a counter when counting is compiled out; every update is a no-op.
+struct NullCounter {
+    NullCounter& operator++() { return *this; }
+    NullCounter& operator+=(std::size_t) { return *this; }
+    NullCounter& operator=(std::size_t) { return *this; }
+    operator std::size_t() const { return 0; }
+};
+
+// Counting policies of BasicStringSortTester. Counter holds the characters read;
+// DetailCounter holds the remaining operation counts of OpCounts. With NoCount
+// both are NullCounter, so the sort loops carry no bookkeeping.
+struct NoCount {
+    using Counter = NullCounter;
+    using DetailCounter = NullCounter;
+};
+
+struct CountChars {
+    using Counter = std::size_t;
+    using DetailCounter = NullCounter;
+};
+
+struct CountDetailed {
+    using Counter = std::size_t;
+    using DetailCounter = std::size_t;
+};
+
+template<typename Count = CountChars>
+class BasicStringSortTester {
+public:
+    using Algo = SortAlgo;
+    static constexpr std::size_t algoCount = (std::size_t)Algo::Burstsort + 1;
+    static constexpr std::size_t defaultCutoff = 15;
+
+    static constexpr bool isParallel(Algo algo) {
+        return algo == Algo::MsdRadixParallel || algo == Algo::MergeLCPParallel || algo == Algo::SampleSortParallel;
+    }
+
+    // Whether algo orders keys by every byte value; MsdRadix and MsdRadixPure only
+    // know PrintableChars and treat any other byte as the end of the key.
+    static constexpr bool sortsAnyBytes(Algo algo) { return algo != Algo::MsdRadix && algo != Algo::MsdRadixPure; }
+
+    // Whether algo reads the base-case size set by setCutoff.
+    static constexpr bool hasCutoff(Algo algo) {
+        return algo == Algo::MsdRadix || algo == Algo::MsdRadixPure || algo == Algo::MsdRadixBytes ||
+               algo == Algo::AmericanFlag || algo == Algo::MsdRadixCached || algo == Algo::MsdRadixParallel;
+    }
+
+    // Sorts handles to the strings of arr and then moves the strings into place in a
+    // single permutation pass.
+    SortResult run(Algo algo, std::vector<std::string>& arr) {
+        resetCounts();
+        pooledBytes = 0;
+        bool counting = AllocCounter::enabled.exchange(trackAllocs, std::memory_order_relaxed);
+        std::size_t allocsBefore = AllocCounter::count.load(std::memory_order_relaxed);
+        std::size_t bytesBefore = AllocCounter::bytes.load(std::memory_order_relaxed);
+        std::size_t liveBefore = AllocCounter::live.load(std::memory_order_relaxed);
+        AllocCounter::resetPeak();
+        if (perf) perf->start();
+        auto start = std::chrono::steady_clock::now();
+
+        assert(arr.size() <= UINT32_MAX);
+        handles.resize(arr.size());
+        pooledBytes += arr.size() * sizeof(KeyHandle);
+        for (std::uint32_t i = 0; i < arr.size(); ++i) {
+            assert(arr[i].size() <= UINT32_MAX);
+            handles[i] = { arr[i].data(), (std::uint32_t)arr[i].size(), i };
+        }
+        sort(algo, handles);
+        applyPermutation(arr, handles);
+
+        auto end = std::chrono::steady_clock::now();
+        HardwareCounts hw;
+        if (perf) hw = perf->stop();
+        OpCounts ops = counts();
+        ops.allocs = AllocCounter::count.load(std::memory_order_relaxed) - allocsBefore;
+        ops.allocBytes = AllocCounter::bytes.load(std::memory_order_relaxed) - bytesBefore;
+        std::size_t peakBytes = AllocCounter::peak.load(std::memory_order_relaxed) - liveBefore + pooledBytes;
+        AllocCounter::enabled.store(counting, std::memory_order_relaxed);
+        if (!trackAllocs) ops.allocs = ops.allocBytes = peakBytes = 0;
+        return { std::chrono::duration_cast<std::chrono::nanoseconds>(end - start), ops, peakBytes, hw, {} };
+    }
+
+    // Whether run() counts heap allocations and peak memory. The counters are shared
+    // atomics, so timing runs should turn this off; the figures are then reported as 0.
+    void setAllocationTracking(bool on) { trackAllocs = on; }
+
+    // Operation counts accumulated since the last run() or resetCounts(), without
+    // the allocation figures, which only run() measures.
+    OpCounts counts() const {
+        OpCounts ops;
+        ops.chars = chars;
+        ops.baseChars = baseChars;
+        ops.compares = compares;
+        ops.moves = moves;
+        ops.maxDepth = maxDepth;
+        ops.baseCases = baseCases;
+        return ops;
+    }
+
+    void resetCounts() {
+        chars = 0;
+        baseChars = compares = moves = baseCases = 0;
+        callDepth = maxDepth = 0;
+    }
+
+    // Sorts keys in place without touching the strings they refer to. Key is
+    // KeyHandle, std::string_view or std::string.
+    template<typename Key>
+    void sort(Algo algo, std::vector<Key>& keys) {
+        switch (algo) {
+        case Algo::StdQuick:
+            stdSort(keys);
+            break;
+        case Algo::StdMergeLCP:
+            mergeSortLCP(keys);
+            break;
+        case Algo::TernaryQuick:
+            ternaryQuickSort(keys, 0, (int)keys.size() - 1);
+            break;
+        case Algo::MsdRadix:
+            msdRadixSort<KeyAlphabet>(keys, cutoff(algo));
+            break;
+        case Algo::MsdRadixPure:
+            msdRadixSort<KeyAlphabet>(keys, cutoff(algo));
+            break;
+        case Algo::MultikeyQuick:
+            multikeyQuickSort(keys, 0, keys.size(), 0);
+            break;
+        case Algo::MsdRadixBytes:
+            msdRadixSort<ByteAlphabet>(keys, cutoff(algo));
+            break;
+        case Algo::AmericanFlag:
+            americanFlagSort<ByteAlphabet>(keys, 0, keys.size(), 0, cutoff(algo));
+            break;
+        case Algo::MsdRadixCached:
+        case Algo::MultikeyQuickCached:
+            prefixCachedSort(algo, keys);
+            break;
+        case Algo::MsdRadixParallel:
+            parallelMsdRadixSort<ByteAlphabet>(keys, cutoff(algo));
+            break;
+        case Algo::MergeLCPParallel:
+            parallelMergeSortLCP(keys);
+            break;
+        case Algo::SampleSort: {
+            std::vector<Key> local;
+            std::vector<std::uint16_t> localOracle;
+            sampleSort(keys, scratchBuffer(0, local, keys.size()), scratchBuffer(0, localOracle, keys.size()),
+                       0, keys.size(), 0);
+            break;
+        }
+        case Algo::SampleSortParallel:
+            parallelSampleSort(keys);
+            break;
+        case Algo::Burstsort:
+            burstsort<ByteAlphabet>(keys);
+            break;
+        }
+    }
+
+    // Size of the burst trie built by the last Burstsort run.
+    struct BurstStats {
+        std::size_t nodes = 0;
+        std::size_t containers = 0;
+        std::size_t bytes = 0;
+    };
+
+    const BurstStats& burstStats() const { return burst; }
+
+    // Base-case size of the radix sorts: ranges of at most n keys are finished by an
+    // LCP insertion sort (multikey quicksort on cached words for MsdRadixCached).
+    // 0 disables the base case; MsdRadixPure defaults to 0.
+    void setCutoff(Algo algo, std::size_t n) { cutoffs[(std::size_t)algo] = n; }
+    std::size_t cutoff(Algo algo) const { return cutoffs[(std::size_t)algo]; }
+
+    // Captures hardware counters around every run() of the calling thread. Returns
+    // false, leaving capture off, when the kernel grants none of the events.
+    bool setHardwareCounters(bool on) {
+        perf.reset();
+        if (!on) return true;
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->available()) perf.reset();
+        return perf != nullptr;
+    }
+
+    // Worker threads for the parallel algorithms; 0 means one per hardware thread.
+    std::size_t threadCount() const { return threads; }
+
+    // Threads a run of algo on n keys uses; the parallel sorts run sequentially at or
+    // below parallelCutoff keys.
+    std::size_t threadsUsed(Algo algo, std::size_t n) const {
+        return isParallel(algo) && n > parallelCutoff ? threads : 1;
+    }
+
+    void setThreads(std::size_t n) {
+        if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+        if (n == threads) return;
+        threads = n;
+        pool.reset();
+    }
+
+    // Sorts arr and returns its LCP array: lcps[i] = lcp(arr[i - 1], arr[i]), lcps[0] = 0.
+    template<typename Key>
+    std::vector<std::size_t> mergeSortLCP(std::vector<Key>& arr) {
+        std::vector<std::size_t> lcps(arr.size(), 0);
+        std::vector<Key> temp(arr.size());
+        std::vector<std::size_t> tempLcps(arr.size());
+        mergeSortLCP(arr, lcps, temp, tempLcps, 0, arr.size());
+        return lcps;
+    }
+
+    // Stable parallel variant of mergeSortLCP with the same result. Every thread sorts
+    // one chunk with mergeSortLCP; the output is split into one range per thread by
+    // splitters drawn from a regular sample of the sorted chunks, and each range is
+    // produced by a K-way LcpLoserTree merge of its pieces of all chunks.
+    template<typename Key>
+    std::vector<std::size_t> parallelMergeSortLCP(std::vector<Key>& arr) {
+        std::size_t n = arr.size();
+        if (n <= parallelCutoff) return mergeSortLCP(arr);
+        WorkStealingPool& tp = threadPool();
+        std::size_t T = tp.size();
+        for (auto& w : workers) w->resetCounts();
+
+        std::vector<std::size_t> lcps(n, 0);
+        std::vector<Key> temp(n);
+        std::vector<std::size_t> tempLcps(n);
+        std::vector<std::size_t> chunk(T + 1);
+        for (std::size_t t = 0; t <= T; ++t) chunk[t] = n * t / T;
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([this, &arr, &lcps, &temp, &tempLcps, &chunk, t](std::size_t w) {
+                workers[w]->mergeSortLCP(arr, lcps, temp, tempLcps, chunk[t], chunk[t + 1]);
+            });
+        }
+        tp.wait();
+
+        const std::size_t oversampling = 8;
+        std::vector<Key> sample;
+        for (std::size_t t = 0; t < T; ++t) {
+            std::size_t len = chunk[t + 1] - chunk[t];
+            for (std::size_t k = 0; k < T * oversampling; ++k)
+                sample.push_back(arr[chunk[t] + len * k / (T * oversampling)]);
+        }
+        auto less = [this](const Key& a, const Key& b) {
+            ++compares;
+            return compareKeys(a, b, chars) < 0;
+        };
+        std::sort(sample.begin(), sample.end(), less);
+
+        // bounds[t][p] is where output range p starts inside chunk t.
+        std::vector<std::vector<std::size_t>> bounds(T, std::vector<std::size_t>(T + 1));
+        for (std::size_t t = 0; t < T; ++t) {
+            bounds[t][0] = chunk[t];
+            bounds[t][T] = chunk[t + 1];
+            for (std::size_t p = 1; p < T; ++p) {
+                const Key& splitter = sample[sample.size() * p / T];
+                bounds[t][p] = std::upper_bound(arr.begin() + bounds[t][p - 1], arr.begin() + chunk[t + 1],
+                                                splitter, less) - arr.begin();
+            }
+        }
+        std::vector<std::size_t> outStart(T + 1, 0);
+        for (std::size_t p = 0; p < T; ++p) {
+            outStart[p + 1] = outStart[p];
+            for (std::size_t t = 0; t < T; ++t) outStart[p + 1] += bounds[t][p + 1] - bounds[t][p];
+        }
+
+        for (std::size_t p = 0; p < T; ++p) {
+            tp.submit([this, &arr, &lcps, &temp, &tempLcps, &bounds, &outStart, T, p](std::size_t w) {
+                std::vector<ArrayRunSource<Key>> runs;
+                for (std::size_t t = 0; t < T; ++t)
+                    runs.push_back({ arr.data() + bounds[t][p], lcps.data() + bounds[t][p],
+                                     bounds[t][p + 1] - bounds[t][p] });
+                std::size_t k = outStart[p];
+                BasicStringSortTester& engine = *workers[w];
+                engine.compares += lcpMerge(std::move(runs), [&](Key& key, std::size_t h) {
+                    temp[k] = std::move(key);
+                    tempLcps[k++] = h;
+                    ++engine.moves;
+                }, engine.chars);
+            });
+        }
+        tp.wait();
+        arr.swap(temp);
+        lcps.swap(tempLcps);
+        for (std::size_t p = 1; p < T; ++p)
+            if (outStart[p] > 0 && outStart[p] < outStart[p + 1])
+                lcps[outStart[p]] = lcp(arr[outStart[p] - 1], arr[outStart[p]]);
+        collectWorkerCounts();
+        return lcps;
+    }
+
+    // Total length of the distinguishing prefixes of a sorted array: the lower bound
+    // on characters any comparison-based string sort has to inspect.
+    template<typename Key>
+    static std::size_t distinguishingPrefix(const std::vector<Key>& sorted,
+                                            const std::vector<std::size_t>& lcps) {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < sorted.size(); ++i) {
+            std::size_t h = i > 0 ? lcps[i] : 0;
+            if (i + 1 < sorted.size()) h = std::max(h, lcps[i + 1]);
+            total += std::min(h + 1, sorted[i].size());
+        }
+        return total;
+    }
+
+private:
+    static constexpr bool detailed = !std::is_same_v<typename Count::DetailCounter, NullCounter>;
+
+    typename Count::Counter chars{};
+    typename Count::DetailCounter baseChars{};
+    typename Count::DetailCounter compares{};
+    typename Count::DetailCounter moves{};
+    typename Count::DetailCounter baseCases{};
+    std::size_t callDepth = 0;
+    std::size_t maxDepth = 0;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<WorkStealingPool> pool;
+    std::vector<std::unique_ptr<BasicStringSortTester>> workers;
+    std::unique_ptr<PerfCounters> perf;
+    std::vector<KeyHandle> handles;
+    std::vector<KeyHandle> scratch;
+    std::vector<CachedKey<KeyHandle>> cachedScratch[2];
+    std::vector<std::uint16_t> oracle;
+    std::vector<std::size_t> baseLcps;
+    struct RadixFrame {
+        std::size_t left;
+        std::size_t right;
+        std::size_t depth;
+    };
+    std::vector<RadixFrame> radixStack;
+    struct CachedFrame {
+        std::size_t left;
+        std::size_t right;
+        std::size_t depth;
+        std::size_t wordDepth;
+    };
+    std::vector<CachedFrame> cachedStack;
+    std::array<std::size_t, algoCount> cutoffs = defaultCutoffs();
+    BurstStats burst;
+    // Part of handles and scratch used by the current sort; both outlive the sort, so
+    // run() adds it to the heap peak instead of seeing it as an allocation.
+    std::size_t pooledBytes = 0;
+    bool trackAllocs = true;
+
+    template<typename Key>
+    std::size_t lcp(const Key& a, const Key& b, std::size_t from = 0) {
+        return lcpFrom(a, b, from, chars);
+    }
+
+    // Marks one level of recursion for maxDepth; compiles to nothing unless detailed.
+    struct DepthScope {
+        BasicStringSortTester& t;
+        explicit DepthScope(BasicStringSortTester& t) : t(t) {
+            if constexpr (detailed) t.maxDepth = std::max(t.maxDepth, ++t.callDepth);
+        }
+        ~DepthScope() {
+            if constexpr (detailed) --t.callDepth;
+        }
+    };
+
+    template<typename T>
+    void swapElems(T& a, T& b) {
+        std::swap(a, b);
+        moves += 3;
+    }
+
+    void collectWorkerCounts() {
+        for (auto& w : workers) {
+            chars += w->chars;
+            baseChars += w->baseChars;
+            compares += w->compares;
+            moves += w->moves;
+            baseCases += w->baseCases;
+            if constexpr (detailed) maxDepth = std::max(maxDepth, callDepth + w->maxDepth);
+        }
+    }
+
+    // std::sort with counted comparisons. Under CountDetailed the keys are sorted
+    // inside wrappers that count their moves, so the wrapper buffer also shows up in
+    // the allocation figures of those runs.
+    template<typename Key>
+    void stdSort(std::vector<Key>& keys) {
+        auto less = [this](const Key& a, const Key& b) {
+            ++compares;
+            return compareKeys(a, b, chars) < 0;
+        };
+        if constexpr (!detailed) {
+            std::sort(keys.begin(), keys.end(), less);
+        } else {
+            struct Counted {
+                Key key;
+                std::size_t* moves;
+                Counted(Key&& k, std::size_t* m) : key(std::move(k)), moves(m) {}
+                Counted(Counted&& o) noexcept : key(std::move(o.key)), moves(o.moves) { ++*moves; }
+                Counted& operator=(Counted&& o) noexcept {
+                    key = std::move(o.key);
+                    moves = o.moves;
+                    ++*moves;
+                    return *this;
+                }
+            };
+            std::vector<Counted> wrapped;
+            wrapped.reserve(keys.size());
+            for (auto& k : keys) wrapped.emplace_back(std::move(k), &moves);
+            std::sort(wrapped.begin(), wrapped.end(), [&](const Counted& a, const Counted& b) {
+                return less(a.key, b.key);
+            });
+            for (std::size_t i = 0; i < keys.size(); ++i) keys[i] = std::move(wrapped[i].key);
+        }
+    }
+
+    template<typename Key>
+    void mergeSortLCP(std::vector<Key>& arr, std::vector<std::size_t>& lcps,
+                      std::vector<Key>& temp, std::vector<std::size_t>& tempLcps,
+                      std::size_t left, std::size_t right) {
+        if (right - left <= 1) return;
+        DepthScope scope(*this);
+        std::size_t mid = (left + right) / 2;
+        mergeSortLCP(arr, lcps, temp, tempLcps, left, mid);
+        mergeSortLCP(arr, lcps, temp, tempLcps, mid, right);
+
+        // lcpI / lcpJ hold the LCP of arr[i] / arr[j] with the last string written out.
+        // The run sharing the longer prefix with it is the smaller one, so characters
+        // are only inspected when both LCPs tie, and then from that depth onwards.
+        std::size_t i = left, j = mid, k = left;
+        std::size_t lcpI = 0, lcpJ = 0;
+
+        while (i < mid && j < right) {
+            if (lcpI > lcpJ) {
+                tempLcps[k] = lcpI;
+                temp[k++] = std::move(arr[i++]);
+                if (i < mid) lcpI = lcps[i];
+            } else if (lcpI < lcpJ) {
+                tempLcps[k] = lcpJ;
+                temp[k++] = std::move(arr[j++]);
+                if (j < right) lcpJ = lcps[j];
+            } else {
+                ++compares;
+                std::size_t h = lcp(arr[i], arr[j], lcpI);
+                bool takeLeft = h == arr[i].size() ||
+                                (h < arr[j].size() && (unsigned char)arr[i][h] < (unsigned char)arr[j][h]);
+                tempLcps[k] = lcpI;
+                if (takeLeft) {
+                    temp[k++] = std::move(arr[i++]);
+                    lcpJ = h;
+                    if (i < mid) lcpI = lcps[i];
+                } else {
+                    temp[k++] = std::move(arr[j++]);
+                    lcpI = h;
+                    if (j < right) lcpJ = lcps[j];
+                }
+            }
+        }
+        while (i < mid) {
+            tempLcps[k] = lcpI;
+            temp[k++] = std::move(arr[i++]);
+            if (i < mid) lcpI = lcps[i];
+        }
+        while (j < right) {
+            tempLcps[k] = lcpJ;
+            temp[k++] = std::move(arr[j++]);
+            if (j < right) lcpJ = lcps[j];
+        }
+
+        for (std::size_t t = left; t < right; ++t) {
+            arr[t] = std::move(temp[t]);
+            lcps[t] = tempLcps[t];
+        }
+        moves += 2 * (right - left);
+    }
+
+    template<typename Key>
+    void ternaryQuickSort(std::vector<Key>& arr, int lo, int hi) {
+        if (lo >= hi) return;
+        DepthScope scope(*this);
+        int lt = lo, gt = hi;
+        int i = lo + 1;
+        while (i <= gt) {
+            ++compares;
+            // arr[lt] always holds a pivot-equal string; arr[lo] does not once it is swapped.
+            int c = compareKeys(arr[i], arr[lt], chars);
+            if (c < 0) swapElems(arr[lt++], arr[i++]);
+            else if (c > 0) swapElems(arr[i], arr[gt--]);
+            else ++i;
+        }
+        ternaryQuickSort(arr, lo, lt - 1);
+        ternaryQuickSort(arr, gt + 1, hi);
+    }
+
+    template<typename Key>
+    int byteAt(const Key& s, std::size_t d) {
+        return d < s.size() ? (unsigned char)s[d] : -1;
+    }
+
+    // digit projects an element to the value partitioned on at the current depth.
+    template<typename T, typename Digit>
+    std::size_t medianOf3(const std::vector<T>& arr, std::size_t a, std::size_t b, std::size_t c, Digit digit) {
+        auto va = digit(arr[a]), vb = digit(arr[b]), vc = digit(arr[c]);
+        if (va < vb) return vb < vc ? b : (va < vc ? c : a);
+        return vb > vc ? b : (va < vc ? a : c);
+    }
+
+    template<typename T, typename Digit>
+    std::size_t choosePivot(const std::vector<T>& arr, std::size_t lo, std::size_t hi, Digit digit) {
+        std::size_t n = hi - lo;
+        std::size_t mid = lo + n / 2, last = hi - 1;
+        if (n < 8) return mid;
+        if (n < 40) return medianOf3(arr, lo, mid, last, digit);
+        std::size_t s = n / 8;
+        return medianOf3(arr,
+                         medianOf3(arr, lo, lo + s, lo + 2 * s, digit),
+                         medianOf3(arr, mid - s, mid, mid + s, digit),
+                         medianOf3(arr, last - 2 * s, last - s, last, digit), digit);
+    }
+
+    // Bentley-Sedgewick multikey quicksort on [lo, hi): three-way partition on the
+    // character at depth d, the equal part continues at d + 1. The two smaller parts
+    // are sorted recursively and the loop continues on the largest one.
+    template<typename Key>
+    void multikeyQuickSort(std::vector<Key>& arr, std::size_t lo, std::size_t hi, std::size_t d) {
+        DepthScope scope(*this);
+        auto digit = [&](const Key& s) {
+            ++chars;
+            return byteAt(s, d);
+        };
+        while (hi - lo > 1) {
+            swapElems(arr[lo], arr[choosePivot(arr, lo, hi, digit)]);
+            int v = digit(arr[lo]);
+            std::size_t lt = lo, gt = hi - 1, i = lo + 1;
+            while (i <= gt) {
+                int c = digit(arr[i]);
+                ++compares;
+                if (c < v) swapElems(arr[lt++], arr[i++]);
+                else if (c > v) swapElems(arr[i], arr[gt--]);
+                else ++i;
+            }
+
+            struct Part { std::size_t lo, hi, d; };
+            Part parts[3] = {
+                { lo, lt, d },
+                { lt, v < 0 ? lt : gt + 1, d + 1 },
+                { gt + 1, hi, d }
+            };
+            std::size_t largest = 0;
+            for (std::size_t p = 1; p < 3; ++p)
+                if (parts[p].hi - parts[p].lo > parts[largest].hi - parts[largest].lo) largest = p;
+            for (std::size_t p = 0; p < 3; ++p)
+                if (p != largest) multikeyQuickSort(arr, parts[p].lo, parts[p].hi, parts[p].d);
+            lo = parts[largest].lo;
+            hi = parts[largest].hi;
+            d = parts[largest].d;
+        }
+    }
+
+    static std::array<std::size_t, algoCount> defaultCutoffs() {
+        std::array<std::size_t, algoCount> c;
+        c.fill(defaultCutoff);
+        c[(std::size_t)Algo::MsdRadixPure] = 0;
+        return c;
+    }
+    static constexpr std::size_t parallelCutoff = 1024;
+    static constexpr std::size_t sampleSortCutoff = 1024;
+    static constexpr std::size_t burstLimit = 1024;
+
+    template<typename Alpha, typename Key>
+    int charAt(const Key& s, std::size_t d) {
+        return d < s.size() ? Alpha::toIndex(s[d]) : -1;
+    }
+
+    template<typename Alpha, typename Key>
+    void msdRadixSort(std::vector<Key>& arr, std::size_t cut) {
+        std::vector<Key> local;
+        msdRadixSort<Alpha>(arr, scratchBuffer(0, local, arr.size()), 0, arr.size(), 0, cut);
+    }
+
+    // Ranges of at most cut strings go to lcpInsertionSort; cut = 0 is the pure
+    // variant. Counts live on the stack and strings are distributed through aux at
+    // the same offsets, so one buffer as large as arr serves the whole sort.
+    // When a pass puts every string into one bucket, the depth jumps to the end of
+    // the common prefix of the range instead of doing one pass per shared character.
+    // Pending buckets are kept on radixStack rather than the call stack. The largest
+    // bucket of each pass is pushed first and so finished last, which keeps at most
+    // R entries per halving of the range size on the stack.
+    template<typename Alpha, typename Key>
+    void msdRadixSort(std::vector<Key>& arr, std::vector<Key>& aux,
+                      std::size_t left, std::size_t right, std::size_t d, std::size_t cut) {
+        std::size_t bottom = radixStack.size();
+        if (right > left + 1) radixStack.push_back({ left, right, d });
+        while (radixStack.size() > bottom) {
+            auto [lo, hi, depth] = radixStack.back();
+            radixStack.pop_back();
+            if (hi - lo <= cut) {
+                lcpInsertionSort(arr, lo, hi, depth);
+                continue;
+            }
+            auto count = distribute<Alpha>(arr, aux, lo, hi, depth);
+            if (singleBucket(count, hi - lo)) {
+                radixStack.push_back({ lo, hi, commonPrefix(arr, lo, hi, depth + 1) });
+                continue;
+            }
+            auto push = [&](int r) {
+                if (count[r + 1] - count[r] > 1) radixStack.push_back({ lo + count[r], lo + count[r + 1], depth + 1 });
+            };
+            int largest = 0;
+            for (int r = 1; r < Alpha::R; ++r)
+                if (count[r + 1] - count[r] > count[largest + 1] - count[largest]) largest = r;
+            push(largest);
+            for (int r = 0; r < Alpha::R; ++r)
+                if (r != largest) push(r);
+            if constexpr (detailed) maxDepth = std::max(maxDepth, callDepth + radixStack.size() - bottom);
+        }
+    }
+
+    // True if every string of a range of n continued with the same character, given
+    // bucket boundaries as returned by distribute.
+    template<std::size_t N>
+    static bool singleBucket(const std::array<std::size_t, N>& count, std::size_t n) {
+        if (count[0] != 0) return false;
+        for (std::size_t r = 0; r + 1 < N; ++r)
+            if (count[r + 1] - count[r] == n) return true;
+        return false;
+    }
+
+    // Length of the common prefix of [left, right), whose strings are known to
+    // agree on their first d characters.
+    template<typename Key>
+    std::size_t commonPrefix(const std::vector<Key>& arr, std::size_t left, std::size_t right, std::size_t d) {
+        const Key& first = arr[left];
+        std::size_t h = first.size();
+        for (std::size_t i = left + 1; i < right && h > d; ++i) {
+            const Key& s = arr[i];
+            std::size_t end = std::min(h, s.size());
+            std::size_t k = end > d ? d + mismatchBytes(s.data() + d, first.data() + d, end - d) : d;
+            chars += k - d + (k < end);
+            h = k;
+        }
+        return std::max(h, d);
+    }
+
+    // One counting and scatter pass on the character at depth d. Bucket r of the
+    // result spans [left + count[r], left + count[r + 1]).
+    template<typename Alpha, typename Key>
+    std::array<std::size_t, Alpha::R + 2> distribute(std::vector<Key>& arr, std::vector<Key>& aux,
+                                                     std::size_t left, std::size_t right, std::size_t d) {
+        std::array<std::size_t, Alpha::R + 2> count{};
+        for (std::size_t i = left; i < right; ++i) {
+            ++count[charAt<Alpha>(arr[i], d) + 2];
+            ++chars;
+        }
+        for (int r = 0; r < Alpha::R + 1; ++r)
+            count[r + 1] += count[r];
+        if (singleBucket(count, right - left)) {
+            // Already in order; leave count as the scatter would.
+            std::copy(count.begin() + 1, count.end(), count.begin());
+            return count;
+        }
+        for (std::size_t i = left; i < right; ++i)
+            aux[left + count[charAt<Alpha>(arr[i], d) + 1]++] = std::move(arr[i]);
+        for (std::size_t i = left; i < right; ++i)
+            arr[i] = std::move(aux[i]);
+        moves += 2 * (right - left);
+        return count;
+    }
+
+    WorkStealingPool& threadPool() {
+        if (!pool) {
+            pool = std::make_unique<WorkStealingPool>(threads);
+            workers.clear();
+            for (std::size_t w = 0; w < pool->size(); ++w)
+                workers.push_back(std::make_unique<BasicStringSortTester>());
+        }
+        return *pool;
+    }
+
+    // The top-level histogram and scatter are split into one chunk per thread; every
+    // bucket then becomes a pool task. Each worker thread counts into its own tester.
+    template<typename Alpha, typename Key>
+    void parallelMsdRadixSort(std::vector<Key>& arr, std::size_t cut) {
+        std::size_t n = arr.size();
+        if (n <= parallelCutoff) {
+            msdRadixSort<Alpha>(arr, cut);
+            return;
+        }
+        WorkStealingPool& tp = threadPool();
+        std::size_t T = tp.size();
+        std::vector<Key> local;
+        std::vector<Key>& aux = scratchBuffer(0, local, n);
+        for (auto& w : workers) w->resetCounts();
+
+        constexpr int B = Alpha::R + 1;
+        std::vector<std::array<std::size_t, B>> offsets(T);
+        auto chunk = [n, T](std::size_t t) { return n * t / T; };
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([this, &arr, &offsets, chunk, t](std::size_t w) {
+                BasicStringSortTester& engine = *workers[w];
+                offsets[t].fill(0);
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i) {
+                    ++offsets[t][engine.charAt<Alpha>(arr[i], 0) + 1];
+                    ++engine.chars;
+                }
+            });
+        }
+        tp.wait();
+
+        std::array<std::size_t, B + 1> bucket{};
+        for (int b = 0; b < B; ++b) {
+            std::size_t pos = bucket[b];
+            for (std::size_t t = 0; t < T; ++t) {
+                std::size_t c = offsets[t][b];
+                offsets[t][b] = pos;
+                pos += c;
+            }
+            bucket[b + 1] = pos;
+        }
+
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([this, &arr, &aux, &offsets, chunk, t](std::size_t w) {
+                BasicStringSortTester& engine = *workers[w];
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i)
+                    aux[offsets[t][engine.charAt<Alpha>(arr[i], 0) + 1]++] = std::move(arr[i]);
+                engine.moves += 2 * (chunk(t + 1) - chunk(t));    // with the copy back below
+            });
+        }
+        tp.wait();
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([&arr, &aux, chunk, t](std::size_t) {
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i)
+                    arr[i] = std::move(aux[i]);
+            });
+        }
+        tp.wait();
+
+        for (int b = 1; b < B; ++b)
+            submitRadixTask<Alpha>(arr, aux, bucket[b], bucket[b + 1], 1, cut);
+        tp.wait();
+        collectWorkerCounts();
+    }
+
+    // Buckets above parallelCutoff are split by one distribution pass on the worker
+    // that picks them up, and their sub-buckets are queued as new tasks.
+    template<typename Alpha, typename Key>
+    void submitRadixTask(std::vector<Key>& arr, std::vector<Key>& aux,
+                         std::size_t left, std::size_t right, std::size_t d, std::size_t cut) {
+        if (right <= left + 1) return;
+        pool->submit([this, &arr, &aux, left, right, d, cut](std::size_t w) {
+            BasicStringSortTester& engine = *workers[w];
+            if (right - left <= parallelCutoff) {
+                engine.msdRadixSort<Alpha>(arr, aux, left, right, d, cut);
+                return;
+            }
+            auto count = engine.distribute<Alpha>(arr, aux, left, right, d);
+            if (singleBucket(count, right - left)) {
+                submitRadixTask<Alpha>(arr, aux, left, right, engine.commonPrefix(arr, left, right, d + 1), cut);
+                return;
+            }
+            for (int r = 0; r < Alpha::R; ++r)
+                submitRadixTask<Alpha>(arr, aux, left + count[r], left + count[r + 1], d + 1, cut);
+        });
+    }
+
+    // In-place MSD radix sort: after counting, every bucket is filled by following
+    // cycles of misplaced strings, so no aux buffer is needed. Single-bucket passes
+    // skip the common prefix as in msdRadixSort.
+    template<typename Alpha, typename Key>
+    void americanFlagSort(std::vector<Key>& arr, std::size_t left, std::size_t right, std::size_t d,
+                          std::size_t cut) {
+        DepthScope scope(*this);
+        constexpr int B = Alpha::R + 1;
+        std::array<std::size_t, B + 1> start;
+        for (;;) {
+            if (right <= left + 1) return;
+            if (right - left <= cut) {
+                lcpInsertionSort(arr, left, right, d);
+                return;
+            }
+            start.fill(0);
+            for (std::size_t i = left; i < right; ++i) {
+                ++start[charAt<Alpha>(arr[i], d) + 2];
+                ++chars;
+            }
+            bool single = false;
+            for (int b = 2; b <= B; ++b) single |= start[b] == right - left;
+            if (!single) break;
+            d = commonPrefix(arr, left, right, d + 1);
+        }
+        start[0] = left;
+        for (int b = 0; b < B; ++b)
+            start[b + 1] += start[b];
+        std::array<std::size_t, B> next;
+        std::copy(start.begin(), start.begin() + B, next.begin());
+
+        for (int b = 0; b < B; ++b) {
+            while (next[b] < start[b + 1]) {
+                int c = charAt<Alpha>(arr[next[b]], d) + 1;
+                ++chars;
+                if (c == b) {
+                    ++next[b];
+                    continue;
+                }
+                Key leader = std::move(arr[next[b]]);
+                do {
+                    swapElems(leader, arr[next[c]++]);
+                    c = charAt<Alpha>(leader, d) + 1;
+                    ++chars;
+                } while (c != b);
+                arr[next[b]++] = std::move(leader);
+                moves += 2;
+            }
+        }
+        for (int b = 1; b < B; ++b)
+            americanFlagSort<Alpha>(arr, start[b], start[b + 1], d + 1, cut);
+    }
+
+    // Insertion sort of [left, right), whose keys share their first d characters.
+    // baseLcps[k] holds the LCP of the k-th sorted key with the one before it. While
+    // the new key x walks left, h is its LCP with the key right of the hole, so the
+    // stored LCP of that key decides most steps without reading characters: a
+    // smaller one means the left key is less than x, a larger one means it is greater.
+    template<typename Key>
+    void lcpInsertionSort(std::vector<Key>& arr, std::size_t left, std::size_t right, std::size_t d) {
+        std::size_t before = chars;
+        std::size_t n = right - left;
+        ++baseCases;
+        if (baseLcps.size() < n + 1) baseLcps.resize(n + 1);
+        std::size_t* lcps = baseLcps.data();
+        for (std::size_t j = 1; j < n; ++j) {
+            Key x = std::move(arr[left + j]);
+            std::size_t i = j, h = d, xl = d;
+            while (i > 0) {
+                const Key& prev = arr[left + i - 1];
+                if (i < j && lcps[i + 1] != h) {
+                    if (lcps[i + 1] < h) {
+                        xl = lcps[i + 1];
+                        break;
+                    }
+                } else {
+                    ++compares;
+                    std::size_t m = lcpFrom(prev, x, h, chars);
+                    bool less = m < x.size() && m < prev.size() ? (unsigned char)x[m] < (unsigned char)prev[m]
+                                                                : x.size() < prev.size();
+                    if (!less) {
+                        xl = m;
+                        break;
+                    }
+                    h = m;
+                }
+                arr[left + i] = std::move(arr[left + i - 1]);
+                ++moves;
+                lcps[i] = lcps[i - 1];
+                --i;
+            }
+            arr[left + i] = std::move(x);
+            moves += 2;
+            lcps[i] = xl;
+            if (i < j) lcps[i + 1] = h;
+        }
+        baseChars += chars - before;
+    }
+
+    template<typename Key>
+    void ternaryQuickSortSuffix(std::vector<Key>& arr, int lo, int hi, std::size_t d) {
+        if (lo >= hi) return;
+        DepthScope scope(*this);
+        int lt = lo, gt = hi;
+        int i = lo + 1;
+        while (i <= gt) {
+            const Key& pivot = arr[lt];
+            if (suffixLess(arr[i], pivot, d)) swapElems(arr[lt++], arr[i++]);
+            else if (suffixLess(pivot, arr[i], d)) swapElems(arr[i], arr[gt--]);
+            else ++i;
+        }
+        ternaryQuickSortSuffix(arr, lo, lt - 1, d);
+        ternaryQuickSortSuffix(arr, gt + 1, hi, d);
+    }
+
+    template<typename Key>
+    bool suffixLess(const Key& a, const Key& b, std::size_t d) {
+        ++compares;
+        std::size_t n = std::min(a.size(), b.size());
+        if (d >= n) {
+            ++chars;
+            return a.size() < b.size();
+        }
+        std::size_t i = d + mismatchBytes(a.data() + d, b.data() + d, n - d);
+        chars += i - d + 1;
+        if (i < n) return (unsigned char)a[i] < (unsigned char)b[i];
+        return a.size() < b.size();
+    }
+
+    // Buffers for the element types run() sorts are pooled on the tester; any other
+    // type gets a fresh buffer in local.
+    template<typename T>
+    std::vector<T>& scratchBuffer(std::size_t slot, std::vector<T>& local, std::size_t n) {
+        std::vector<T>* buf = &local;
+        if constexpr (std::is_same_v<T, KeyHandle>) buf = &scratch;
+        else if constexpr (std::is_same_v<T, CachedKey<KeyHandle>>) buf = &cachedScratch[slot];
+        else if constexpr (std::is_same_v<T, std::uint16_t>) buf = &oracle;
+        if (buf->size() < n) buf->resize(n);
+        if (buf != &local) pooledBytes += n * sizeof(T);
+        return *buf;
+    }
+
+    template<typename Key>
+    static std::size_t cachedBytes(const Key& s, std::size_t d) {
+        return s.size() > d ? std::min<std::size_t>(8, s.size() - d) : 0;
+    }
+
+    template<typename Key>
+    std::uint64_t loadWord(const Key& s, std::size_t d) {
+        std::size_t n = cachedBytes(s, d);
+        chars += n;
+        std::uint64_t w = 0;
+        if (n == 8) {
+            std::memcpy(&w, s.data() + d, 8);
+            return __builtin_bswap64(w);
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            w |= (std::uint64_t)(unsigned char)s[d + i] << (56 - 8 * i);
+        return w;
+    }
+
+    template<typename Key>
+    void reloadWords(std::vector<CachedKey<Key>>& arr, std::size_t lo, std::size_t hi, std::size_t d) {
+        for (std::size_t i = lo; i < hi; ++i)
+            arr[i].word = loadWord(arr[i].key, d);
+    }
+
+    // Zero padding makes a key ending inside the window look like one continuing
+    // with '\0', so equal words are told apart by the number of real bytes.
+    template<typename Key>
+    static std::pair<std::uint64_t, std::size_t> cachedDigit(const CachedKey<Key>& k, std::size_t d) {
+        return { k.word, cachedBytes(k.key, d) };
+    }
+
+    template<typename Alpha, typename Key>
+    static int cachedCharAt(const CachedKey<Key>& k, std::size_t d, std::size_t wordDepth) {
+        std::size_t off = d - wordDepth;
+        return off < cachedBytes(k.key, wordDepth) ? Alpha::toIndex((char)(k.word >> (56 - 8 * off))) : -1;
+    }
+
+    template<typename Key>
+    void prefixCachedSort(Algo algo, std::vector<Key>& keys) {
+        std::size_t n = keys.size();
+        std::vector<CachedKey<Key>> local, localAux;
+        auto& cached = scratchBuffer(0, local, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            cached[i].word = loadWord(keys[i], 0);
+            cached[i].key = std::move(keys[i]);
+        }
+        moves += 2 * n;
+        if (algo == Algo::MsdRadixCached)
+            msdRadixSortCached<ByteAlphabet>(cached, scratchBuffer(1, localAux, n), 0, n, 0, 0, cutoff(algo));
+        else
+            multikeyQuickSortCached(cached, 0, n, 0);
+        for (std::size_t i = 0; i < n; ++i)
+            keys[i] = std::move(cached[i].key);
+    }
+
+    // Multikey quicksort on 8-byte words: all words in [lo, hi) are loaded at depth d,
+    // and the equal part is reloaded once and continues at d + 8.
+    template<typename Key>
+    void multikeyQuickSortCached(std::vector<CachedKey<Key>>& arr, std::size_t lo, std::size_t hi, std::size_t d) {
+        DepthScope scope(*this);
+        while (hi - lo > 1) {
+            auto digit = [&](const CachedKey<Key>& k) { return cachedDigit(k, d); };
+            swapElems(arr[lo], arr[choosePivot(arr, lo, hi, digit)]);
+            auto v = digit(arr[lo]);
+            std::size_t lt = lo, gt = hi - 1, i = lo + 1;
+            while (i <= gt) {
+                auto c = digit(arr[i]);
+                ++compares;
+                if (c < v) swapElems(arr[lt++], arr[i++]);
+                else if (v < c) swapElems(arr[i], arr[gt--]);
+                else ++i;
+            }
+
+            bool more = v.second == 8;
+            if (more) reloadWords(arr, lt, gt + 1, d + 8);
+            struct Part { std::size_t lo, hi, d; };
+            Part parts[3] = {
+                { lo, lt, d },
+                { lt, more ? gt + 1 : lt, d + 8 },
+                { gt + 1, hi, d }
+            };
+            std::size_t largest = 0;
+            for (std::size_t p = 1; p < 3; ++p)
+                if (parts[p].hi - parts[p].lo > parts[largest].hi - parts[largest].lo) largest = p;
+            for (std::size_t p = 0; p < 3; ++p)
+                if (p != largest) multikeyQuickSortCached(arr, parts[p].lo, parts[p].hi, parts[p].d);
+            lo = parts[largest].lo;
+            hi = parts[largest].hi;
+            d = parts[largest].d;
+        }
+    }
+
+    // MSD radix sort whose digits come from words loaded at wordDepth; a bucket only
+    // reloads once d leaves that window. Small ranges go to multikeyQuickSortCached.
+    // As in msdRadixSort, pending buckets are kept on a stack with the largest pushed
+    // first, and a pass that leaves every key in one bucket moves d to the end of the
+    // prefix all loaded words share instead of doing one pass per shared character.
+    template<typename Alpha, typename Key>
+    void msdRadixSortCached(std::vector<CachedKey<Key>>& arr, std::vector<CachedKey<Key>>& aux,
+                            std::size_t left, std::size_t right, std::size_t d, std::size_t wordDepth,
+                            std::size_t cut) {
+        std::size_t bottom = cachedStack.size();
+        if (right > left + 1) cachedStack.push_back({ left, right, d, wordDepth });
+        while (cachedStack.size() > bottom) {
+            auto [lo, hi, depth, wd] = cachedStack.back();
+            cachedStack.pop_back();
+            if (hi - lo <= cut || depth - wd == 8) {
+                reloadWords(arr, lo, hi, depth);
+                wd = depth;
+            }
+            if (hi - lo <= cut) {
+                std::size_t before = chars;
+                ++baseCases;
+                multikeyQuickSortCached(arr, lo, hi, depth);
+                baseChars += chars - before;
+                continue;
+            }
+            std::array<std::size_t, Alpha::R + 2> count{};
+            for (std::size_t i = lo; i < hi; ++i)
+                ++count[cachedCharAt<Alpha>(arr[i], depth, wd) + 2];
+            for (int r = 0; r < Alpha::R + 1; ++r)
+                count[r + 1] += count[r];
+            if (count[1] == 0 && singleBucket(count, hi - lo)) {
+                cachedStack.push_back({ lo, hi, wd + cachedCommonPrefix(arr, lo, hi, wd), wd });
+                continue;
+            }
+            for (std::size_t i = lo; i < hi; ++i)
+                aux[lo + count[cachedCharAt<Alpha>(arr[i], depth, wd) + 1]++] = std::move(arr[i]);
+            for (std::size_t i = lo; i < hi; ++i)
+                arr[i] = std::move(aux[i]);
+            moves += 2 * (hi - lo);
+            auto push = [&](int r) {
+                if (count[r + 1] - count[r] > 1)
+                    cachedStack.push_back({ lo + count[r], lo + count[r + 1], depth + 1, wd });
+            };
+            int largest = 0;
+            for (int r = 1; r < Alpha::R; ++r)
+                if (count[r + 1] - count[r] > count[largest + 1] - count[largest]) largest = r;
+            push(largest);
+            for (int r = 0; r < Alpha::R; ++r)
+                if (r != largest) push(r);
+            if constexpr (detailed) maxDepth = std::max(maxDepth, callDepth + cachedStack.size() - bottom);
+        }
+    }
+
+    // Number of bytes from wordDepth on which every cached word of [lo, hi) agrees
+    // and that are real key bytes in all of them.
+    template<typename Key>
+    static std::size_t cachedCommonPrefix(const std::vector<CachedKey<Key>>& arr, std::size_t lo, std::size_t hi,
+                                          std::size_t wordDepth) {
+        std::uint64_t first = arr[lo].word;
+        std::size_t h = 8;
+        for (std::size_t i = lo; i < hi && h > 0; ++i) {
+            std::uint64_t x = arr[i].word ^ first;
+            h = std::min({ h, x ? (std::size_t)__builtin_clzll(x) / 8 : 8, cachedBytes(arr[i].key, wordDepth) });
+        }
+        return h;
+    }
+
+    // Draws splitters for [lo, hi) at depth d from a pseudo-random sample of the
+    // range's 8-byte words, with two sample words per splitter.
+    template<typename Key>
+    SplitterTree drawSplitters(const std::vector<Key>& arr, std::size_t lo, std::size_t hi, std::size_t d) {
+        std::size_t n = hi - lo;
+        std::size_t levels = 1;
+        while (levels < SplitterTree::maxLevels && (std::size_t(32) << levels) <= n) ++levels;
+        SplitterTree st;
+        std::size_t splitters = (std::size_t(1) << levels) - 1;
+        const std::size_t oversampling = 2;
+        std::vector<std::uint64_t> sample((splitters + 1) * oversampling);
+        std::minstd_rand rng((unsigned)(n * 31 + d));
+        for (auto& w : sample)
+            w = loadWord(arr[lo + rng() % n], d);
+        std::sort(sample.begin(), sample.end());
+        for (std::size_t j = 0; j < splitters; ++j)
+            st.sorted[j] = sample[(j + 1) * oversampling - 1];
+        st.build(levels);
+        return st;
+    }
+
+    // Classifies [lo, hi) into oracle and distributes by bucket through aux; bucket b
+    // of the result spans [lo + bounds[b], lo + bounds[b + 1]).
+    template<typename Key>
+    std::array<std::size_t, 2 * (1 << SplitterTree::maxLevels)> sampleDistribute(
+            std::vector<Key>& arr, std::vector<Key>& aux, std::vector<std::uint16_t>& oracle,
+            std::size_t lo, std::size_t hi, std::size_t d, const SplitterTree& st) {
+        std::array<std::size_t, 2 * (1 << SplitterTree::maxLevels)> bounds{};
+        for (std::size_t i = lo; i < hi; ++i) {
+            oracle[i] = (std::uint16_t)st.classify(loadWord(arr[i], d));
+            ++bounds[oracle[i] + 1];
+        }
+        compares += (hi - lo) * (st.levels + 1);
+        for (std::size_t b = 0; b < st.buckets(); ++b)
+            bounds[b + 1] += bounds[b];
+        auto next = bounds;
+        for (std::size_t i = lo; i < hi; ++i)
+            aux[lo + next[oracle[i]]++] = std::move(arr[i]);
+        for (std::size_t i = lo; i < hi; ++i)
+            arr[i] = std::move(aux[i]);
+        moves += 2 * (hi - lo);
+        return bounds;
+    }
+
+    // Keys equal to a splitter continue 8 characters deeper, unless the splitter ends
+    // in a zero byte: then the bucket may mix keys that end inside the word with keys
+    // that contain '\0', and multikey quicksort settles it from depth d.
+    template<typename Key>
+    void sampleSortBucket(std::vector<Key>& arr, std::vector<Key>& aux, std::vector<std::uint16_t>& oracle,
+                          std::size_t lo, std::size_t hi, std::size_t d, const SplitterTree& st, std::size_t b) {
+        if (hi <= lo + 1) return;
+        if (b % 2 == 0)
+            sampleSort(arr, aux, oracle, lo, hi, d);
+        else if (st.sorted[b / 2] & 0xFF)
+            sampleSort(arr, aux, oracle, lo, hi, d + 8);
+        else
+            multikeyQuickSort(arr, lo, hi, d);
+    }
+
+    // Super Scalar String Sample Sort: distributes [lo, hi) into up to 511 buckets per
+    // step by the 8-byte word at depth d; small ranges go to multikey quicksort.
+    template<typename Key>
+    void sampleSort(std::vector<Key>& arr, std::vector<Key>& aux, std::vector<std::uint16_t>& oracle,
+                    std::size_t lo, std::size_t hi, std::size_t d) {
+        if (hi - lo <= sampleSortCutoff) {
+            std::size_t before = chars;
+            ++baseCases;
+            multikeyQuickSort(arr, lo, hi, d);
+            baseChars += chars - before;
+            return;
+        }
+        DepthScope scope(*this);
+        SplitterTree st = drawSplitters(arr, lo, hi, d);
+        auto bounds = sampleDistribute(arr, aux, oracle, lo, hi, d, st);
+        for (std::size_t b = 0; b < st.buckets(); ++b)
+            sampleSortBucket(arr, aux, oracle, lo + bounds[b], lo + bounds[b + 1], d, st, b);
+    }
+
+    // Top-level classification and scatter run in one chunk per thread, as in
+    // parallelMsdRadixSort; buckets become pool tasks.
+    template<typename Key>
+    void parallelSampleSort(std::vector<Key>& arr) {
+        std::size_t n = arr.size();
+        std::vector<Key> local;
+        std::vector<std::uint16_t> localOracle;
+        std::vector<Key>& aux = scratchBuffer(0, local, n);
+        std::vector<std::uint16_t>& orc = scratchBuffer(0, localOracle, n);
+        if (n <= parallelCutoff) {
+            sampleSort(arr, aux, orc, 0, n, 0);
+            return;
+        }
+        WorkStealingPool& tp = threadPool();
+        std::size_t T = tp.size();
+        for (auto& w : workers) w->resetCounts();
+
+        SplitterTree st = drawSplitters(arr, 0, n, 0);
+        std::size_t B = st.buckets();
+        std::vector<std::vector<std::size_t>> offsets(T, std::vector<std::size_t>(B, 0));
+        auto chunk = [n, T](std::size_t t) { return n * t / T; };
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([this, &arr, &orc, &offsets, &st, chunk, t](std::size_t w) {
+                BasicStringSortTester& engine = *workers[w];
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i) {
+                    orc[i] = (std::uint16_t)st.classify(engine.loadWord(arr[i], 0));
+                    ++offsets[t][orc[i]];
+                }
+                engine.compares += (chunk(t + 1) - chunk(t)) * (st.levels + 1);
+            });
+        }
+        tp.wait();
+
+        std::vector<std::size_t> bucket(B + 1, 0);
+        for (std::size_t b = 0; b < B; ++b) {
+            std::size_t pos = bucket[b];
+            for (std::size_t t = 0; t < T; ++t) {
+                std::size_t c = offsets[t][b];
+                offsets[t][b] = pos;
+                pos += c;
+            }
+            bucket[b + 1] = pos;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([this, &arr, &aux, &orc, &offsets, chunk, t](std::size_t w) {
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i)
+                    aux[offsets[t][orc[i]]++] = std::move(arr[i]);
+                workers[w]->moves += 2 * (chunk(t + 1) - chunk(t));    // with the copy back below
+            });
+        }
+        tp.wait();
+        for (std::size_t t = 0; t < T; ++t) {
+            tp.submit([&arr, &aux, chunk, t](std::size_t) {
+                for (std::size_t i = chunk(t); i < chunk(t + 1); ++i)
+                    arr[i] = std::move(aux[i]);
+            });
+        }
+        tp.wait();
+
+        for (std::size_t b = 0; b < B; ++b)
+            submitSampleSortTask(arr, aux, orc, bucket[b], bucket[b + 1], 0, st, b);
+        tp.wait();
+        collectWorkerCounts();
+    }
+
+    template<typename Key>
+    void submitSampleSortTask(std::vector<Key>& arr, std::vector<Key>& aux, std::vector<std::uint16_t>& orc,
+                              std::size_t lo, std::size_t hi, std::size_t d, const SplitterTree& parent,
+                              std::size_t b) {
+        if (hi <= lo + 1) return;
+        bool equal = b % 2 == 1;
+        if (equal && !(parent.sorted[b / 2] & 0xFF)) {
+            pool->submit([this, &arr, lo, hi, d](std::size_t w) {
+                workers[w]->multikeyQuickSort(arr, lo, hi, d);
+            });
+            return;
+        }
+        std::size_t depth = equal ? d + 8 : d;
+        pool->submit([this, &arr, &aux, &orc, lo, hi, depth](std::size_t w) {
+            BasicStringSortTester& engine = *workers[w];
+            if (hi - lo <= parallelCutoff) {
+                engine.sampleSort(arr, aux, orc, lo, hi, depth);
+                return;
+            }
+            SplitterTree st = engine.drawSplitters(arr, lo, hi, depth);
+            auto bounds = engine.sampleDistribute(arr, aux, orc, lo, hi, depth, st);
+            for (std::size_t c = 0; c < st.buckets(); ++c)
+                submitSampleSortTask(arr, aux, orc, lo + bounds[c], lo + bounds[c + 1], depth, st, c);
+        });
+    }
+
+    // Burst trie node: slot 0 holds keys that end at this depth, slot c + 1 keys whose
+    // next character has digit c, either in a container or below a child node.
+    template<typename Key, int Slots>
+    struct BurstNode {
+        std::array<std::unique_ptr<BurstNode>, Slots> child;
+        std::array<std::vector<Key>, Slots> bucket;
+    };
+
+    // Inserts every key into a burst trie whose containers are burst into a new node
+    // once they exceed burstLimit keys, then walks the trie in order and sorts each
+    // container with ternaryQuickSortSuffix from the container's depth.
+    template<typename Alpha, typename Key>
+    void burstsort(std::vector<Key>& arr) {
+        using Node = BurstNode<Key, Alpha::R + 1>;
+        burst = {};
+        auto root = std::make_unique<Node>();
+        ++burst.nodes;
+        for (auto& key : arr) {
+            Node* node = root.get();
+            std::size_t d = 0;
+            int slot = charAt<Alpha>(key, d) + 1;
+            ++chars;
+            while (node->child[slot]) {
+                node = node->child[slot].get();
+                slot = charAt<Alpha>(key, ++d) + 1;
+                ++chars;
+            }
+            auto& bucket = node->bucket[slot];
+            bucket.push_back(std::move(key));
+            ++moves;
+            if (slot > 0 && bucket.size() > burstLimit) burstContainer<Alpha>(*node, slot, d + 1);
+        }
+        std::size_t out = 0;
+        burstTraverse(*root, arr, out, 0);
+    }
+
+    template<typename Alpha, typename Node>
+    void burstContainer(Node& node, int slot, std::size_t d) {
+        auto child = std::make_unique<Node>();
+        ++burst.nodes;
+        auto keys = std::move(node.bucket[slot]);
+        node.bucket[slot] = {};
+        for (auto& key : keys) {
+            child->bucket[charAt<Alpha>(key, d) + 1].push_back(std::move(key));
+            ++chars;
+        }
+        moves += keys.size();
+        for (int c = 1; c < (int)child->bucket.size(); ++c)
+            if (child->bucket[c].size() > burstLimit) burstContainer<Alpha>(*child, c, d + 1);
+        node.child[slot] = std::move(child);
+    }
+
+    template<typename Node, typename Key>
+    void burstTraverse(Node& node, std::vector<Key>& arr, std::size_t& out, std::size_t d) {
+        DepthScope scope(*this);
+        burst.bytes += sizeof(Node);
+        for (std::size_t slot = 0; slot < node.bucket.size(); ++slot) {
+            if (node.child[slot]) {
+                burstTraverse(*node.child[slot], arr, out, d + 1);
+                continue;
+            }
+            auto& bucket = node.bucket[slot];
+            if (bucket.empty()) continue;
+            ++burst.containers;
+            burst.bytes += bucket.capacity() * sizeof(Key);
+            if (slot > 0) {
+                std::size_t before = chars;
+                ++baseCases;
+                ternaryQuickSortSuffix(bucket, 0, (int)bucket.size() - 1, d + 1);
+                baseChars += chars - before;
+            }
+            for (auto& key : bucket) arr[out++] = std::move(key);
+            moves += bucket.size();
+        }
+    }
+
+    // Moves arr into the order described by keys[i].idx with one pass over the
+    // permutation cycles; keys is consumed as the visited marker.
+    static void applyPermutation(std::vector<std::string>& arr, std::vector<KeyHandle>& keys) {
+        for (std::uint32_t i = 0; i < keys.size(); ++i) {
+            if (keys[i].idx == i) continue;
+            std::string held = std::move(arr[i]);
+            std::uint32_t j = i;
+            while (keys[j].idx != i) {
+                std::uint32_t from = keys[j].idx;
+                arr[j] = std::move(arr[from]);
+                keys[j].idx = j;
+                j = from;
+            }
+            arr[j] = std::move(held);
+            keys[j].idx = j;
+        }
+    }
+};
+
+using StringSortTester = BasicStringSortTester<CountChars>;
+
+// Output file written through a fixed-size buffer.
+class BufferedWriter {
+public:
+    BufferedWriter(const std::filesystem::path& path, std::size_t bufferSize)
+        : out(path, std::ios::binary | std::ios::trunc), path(path)
+    {
+        if (!out) throw std::runtime_error("cannot open " + path.string() + " for writing");
+        buf.reserve(std::max<std::size_t>(bufferSize, 64));
+    }
+
+    void put(const char* data, std::size_t n) {
+        while (n > 0) {
+            std::size_t take = std::min(n, buf.capacity() - buf.size());
+            buf.insert(buf.end(), data, data + take);
+            data += take;
+            n -= take;
+            if (buf.size() == buf.capacity()) flush();
+        }
+    }
+
+    void put(char c) { put(&c, 1); }
+
+    void putVarint(std::size_t v) {
+        char bytes[10];
+        std::size_t n = 0;
+        for (; v >= 0x80; v >>= 7) bytes[n++] = char(v | 0x80);
+        bytes[n++] = char(v);
+        put(bytes, n);
+    }
+
+    void flush() {
+        out.write(buf.data(), buf.size());
+        written += buf.size();
+        buf.clear();
+        if (!out) throw std::runtime_error("write to " + path.string() + " failed");
+    }
+
+    void close() {
+        flush();
+        out.close();
+        if (!out) throw std::runtime_error("closing " + path.string() + " failed");
+    }
+
+    std::size_t bytesWritten() const { return written + buf.size(); }
+
+private:
+    std::ofstream out;
+    std::filesystem::path path;
+    std::vector<char> buf;
+    std::size_t written = 0;
+};
 
-    StringGenerator(unsigned seed = std::random_device{}())
-        : gen(seed),
-          distLen(10, 200)
+// Input file read through a fixed-size buffer.
+class BufferedReader {
+public:
+    BufferedReader(const std::filesystem::path& path, std::size_t bufferSize)
+        : in(path, std::ios::binary), path(path), buf(std::max<std::size_t>(bufferSize, 64))
     {
-        alphabet =
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz"
-            "0123456789"
-            "!@#%:;^&*()-.";
-        distChar = std::uniform_int_distribution<int>(0, (int)alphabet.size() - 1);
+        if (!in) throw std::runtime_error("cannot open " + path.string() + " for reading");
+    }
+
+    bool get(char& c) {
+        if (pos == end && !fill()) return false;
+        c = buf[pos++];
+        return true;
+    }
+
+    // Reads exactly n bytes; a short read is an error.
+    void read(char* data, std::size_t n) {
+        while (n > 0) {
+            if (pos == end && !fill()) throw std::runtime_error(path.string() + ": unexpected end of file");
+            std::size_t take = std::min(n, end - pos);
+            std::memcpy(data, buf.data() + pos, take);
+            pos += take;
+            data += take;
+            n -= take;
+        }
+    }
+
+    bool getVarint(std::size_t& v) {
+        v = 0;
+        char c;
+        for (int shift = 0; get(c); shift += 7) {
+            v |= std::size_t((unsigned char)c & 0x7f) << shift;
+            if (!((unsigned char)c & 0x80)) return true;
+        }
+        if (v != 0) throw std::runtime_error(path.string() + ": truncated record");
+        return false;
+    }
 
-        maxSize = 3000;
-        for (Kind kind : {Kind::Random, Kind::Reverse, Kind::AlmostSorted}) {
-            auto bigSample = generateRawSample(maxSize);
-            if (kind == Kind::Reverse) {
-                std::sort(bigSample.begin(), bigSample.end(), std::greater<>());
-            } else if (kind == Kind::AlmostSorted) {
-                std::sort(bigSample.begin(), bigSample.end());
-                for (size_t i = 0; i + 1 < bigSample.size(); i += 10)
-                    std::swap(bigSample[i], bigSample[i + 1]);
+    // Reads up to the next '\n', which is dropped. Returns false at end of file.
+    bool getLine(std::string& line) {
+        line.clear();
+        for (;;) {
+            if (pos == end && !fill()) return !line.empty();
+            const char* start = buf.data() + pos;
+            const char* nl = static_cast<const char*>(std::memchr(start, '\n', end - pos));
+            std::size_t take = nl ? nl - start : end - pos;
+            line.append(start, take);
+            pos += take;
+            if (nl) {
+                ++pos;
+                return true;
             }
-            samples[kind] = std::move(bigSample);
         }
     }
 
-    std::vector<std::string> getSample(std::size_t size, Kind kind) {
-        assert(size <= maxSize);
-        return std::vector<std::string>(samples[kind].begin(), samples[kind].begin() + size);
+private:
+    std::ifstream in;
+    std::filesystem::path path;
+    std::vector<char> buf;
+    std::size_t pos = 0;
+    std::size_t end = 0;
+
+    bool fill() {
+        in.read(buf.data(), buf.size());
+        if (in.bad()) throw std::runtime_error("read from " + path.string() + " failed");
+        pos = 0;
+        end = in.gcount();
+        return end > 0;
+    }
+};
+
+// Sorted run on disk. Keys are front coded: each record is the LCP with the
+// previous key and the remaining suffix, both lengths as varints.
+class RunWriter {
+public:
+    RunWriter(const std::filesystem::path& path, std::size_t bufferSize) : out(path, bufferSize) {}
+
+    void write(std::string_view key, std::size_t lcp) {
+        out.putVarint(lcp);
+        out.putVarint(key.size() - lcp);
+        out.put(key.data() + lcp, key.size() - lcp);
     }
 
+    void close() { out.close(); }
+    std::size_t bytesWritten() const { return out.bytesWritten(); }
+
 private:
-    std::mt19937 gen;
-    std::uniform_int_distribution<int> distLen;
-    std::uniform_int_distribution<int> distChar;
-    std::string alphabet;
-    std::size_t maxSize;
+    BufferedWriter out;
+};
 
-    std::unordered_map<Kind, std::vector<std::string>> samples;
+// LcpLoserTree source over a run written by RunWriter.
+class RunReader {
+public:
+    RunReader(const std::filesystem::path& path, std::size_t bufferSize) : in(path, bufferSize) { next(); }
 
-    std::vector<std::string> generateRawSample(std::size_t size) {
-        std::vector<std::string> res;
-        res.reserve(size);
-        for (size_t i = 0; i < size; ++i) {
-            int len = distLen(gen);
-            std::string s(len, ' ');
-            for (int j = 0; j < len; ++j) {
-                s[j] = alphabet[distChar(gen)];
-            }
-            res.push_back(std::move(s));
+    bool empty() const { return done; }
+    const std::string& key() const { return current; }
+    std::size_t lcp() const { return currentLcp; }
+
+    void next() {
+        std::size_t suffix;
+        if (!in.getVarint(currentLcp)) {
+            done = true;
+            return;
         }
-        return res;
+        if (!in.getVarint(suffix) || currentLcp > current.size())
+            throw std::runtime_error("corrupt run file");
+        current.resize(currentLcp + suffix);
+        in.read(current.data() + currentLcp, suffix);
     }
-};
 
-struct SortResult {
-    std::chrono::milliseconds time;
-    std::size_t comps;
+private:
+    BufferedReader in;
+    std::string current;
+    std::size_t currentLcp = 0;
+    bool done = false;
 };
 
-class StringSortTester {
+// Sorts newline-delimited keys that need not fit in memory. The input is cut into
+// chunks that fit the memory limit, each chunk is sorted in memory by the chosen
+// algorithm and written as a front-coded run, and the runs are combined by K-way
+// LcpLoserTree merges. When there are more runs than maxFanIn, intermediate merge
+// passes write new runs using the LCPs the tree already knows.
+class ExternalSorter {
 public:
-    enum class Algo { StdQuick, StdMergeLCP, TernaryQuick, MsdRadix, MsdRadixPure };
+    struct Options {
+        std::size_t memoryLimit = std::size_t(256) << 20;
+        std::filesystem::path tempDir = std::filesystem::temp_directory_path();
+        StringSortTester::Algo algo = StringSortTester::Algo::MsdRadixBytes;
+        std::size_t threads = 0;    // for a parallel algo; 0 is one per hardware thread
+        std::size_t bufferSize = std::size_t(1) << 16;
+        std::size_t maxFanIn = 64;
+    };
 
-    SortResult run(Algo algo, std::vector<std::string>& arr) {
-        comps = 0;
-        auto start = std::chrono::high_resolution_clock::now();
+    struct Stats {
+        std::chrono::nanoseconds time{ 0 };
+        std::size_t keys = 0;
+        std::size_t runs = 0;
+        std::size_t mergePasses = 0;
+        std::size_t runBytes = 0;
+        std::size_t comps = 0;  // characters read for run LCPs and by the merges; the run sort is not counted
+    };
 
-        switch (algo) {
-        case Algo::StdQuick:
-            std::sort(arr.begin(), arr.end(), [this](const std::string& a, const std::string& b) {
-                ++comps;
-                return a < b;
-            });
-            break;
-        case Algo::StdMergeLCP:
-            mergeSortLCP(arr, 0, arr.size());
-            break;
-        case Algo::TernaryQuick:
-            ternaryQuickSort(arr, 0, arr.size() - 1);
-            break;
-        case Algo::MsdRadix:
-            msdRadixSort(arr, 0, arr.size(), 0);
-            break;
-        case Algo::MsdRadixPure:
-            msdRadixSortPure(arr, 0, arr.size(), 0);
-            break;
+    explicit ExternalSorter(Options options) : options(std::move(options)) {
+        tester.setAllocationTracking(false);
+        tester.setThreads(this->options.threads);
+    }
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    ~ExternalSorter() {
+        for (auto& p : temps) {
+            std::error_code ec;
+            std::filesystem::remove(p, ec);
+        }
+    }
+
+    Stats sort(const std::filesystem::path& input, const std::filesystem::path& output) {
+        Stats stats;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::filesystem::path> runs = formRuns(input, stats);
+        stats.runs = runs.size();
+        // A pass must merge at least two runs per group to make progress.
+        const std::size_t fanIn = std::max<std::size_t>(options.maxFanIn, 2);
+        while (runs.size() > fanIn) {
+            std::vector<std::filesystem::path> merged;
+            for (std::size_t i = 0; i < runs.size(); i += fanIn) {
+                std::vector<std::filesystem::path> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + fanIn));
+                merged.push_back(tempPath());
+                RunWriter out(merged.back(), options.bufferSize);
+                merge(group, stats, [&](const std::string& key, std::size_t lcp) { out.write(key, lcp); });
+                out.close();
+                stats.runBytes += out.bytesWritten();
+                for (auto& p : group) release(p);
+            }
+            runs.swap(merged);
+            ++stats.mergePasses;
         }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        return { std::chrono::duration_cast<std::chrono::milliseconds>(end - start), comps };
+        BufferedWriter out(output, options.bufferSize);
+        merge(runs, stats, [&](const std::string& key, std::size_t) {
+            out.put(key.data(), key.size());
+            out.put('\n');
+        });
+        out.close();
+        ++stats.mergePasses;
+        for (auto& p : runs) release(p);
+        stats.time = std::chrono::steady_clock::now() - start;
+        return stats;
+    }
+
+    // Worker threads used by the parallel in-memory algorithms.
+    void setThreads(std::size_t n) { tester.setThreads(n); }
+
+    // Random tag that keeps the files of concurrent sorts in one temp directory apart.
+    static std::string uniqueTag() {
+        std::random_device rd;
+        return std::to_string(rd()) + "-" + std::to_string(rd());
     }
 
 private:
-    std::size_t comps = 0;
+    Options options;
+    BasicStringSortTester<NoCount> tester;
+    std::vector<std::filesystem::path> temps;
+    std::string tag;
+
+    std::vector<std::filesystem::path> formRuns(const std::filesystem::path& input, Stats& stats) {
+        // Per key: the string, its handle plus sort scratch, and its LCP.
+        const std::size_t overhead = sizeof(std::string) + 2 * sizeof(KeyHandle) + sizeof(std::size_t);
+        std::vector<std::filesystem::path> runs;
+        std::vector<std::string> chunk;
+        std::vector<std::size_t> lcps;
+        std::size_t used = 0;
 
-    int lcp(const std::string& a, const std::string& b) {
-        int i = 0;
-        while (i < (int)a.size() && i < (int)b.size() && a[i] == b[i]) ++i;
-        return i;
+        auto flushChunk = [&]() {
+            if (chunk.empty()) return;
+            tester.run(options.algo, chunk);
+            lcps.assign(chunk.size(), 0);
+            for (std::size_t i = 1; i < chunk.size(); ++i)
+                lcps[i] = lcpFrom(chunk[i - 1], chunk[i], 0, stats.comps);
+            runs.push_back(tempPath());
+            RunWriter out(runs.back(), options.bufferSize);
+            for (std::size_t i = 0; i < chunk.size(); ++i) out.write(chunk[i], lcps[i]);
+            out.close();
+            stats.runBytes += out.bytesWritten();
+            chunk.clear();
+            used = 0;
+        };
+
+        BufferedReader in(input, options.bufferSize);
+        std::string line;
+        while (in.getLine(line)) {
+            std::size_t cost = line.size() + overhead;
+            if (used + cost > options.memoryLimit) flushChunk();
+            used += cost;
+            chunk.push_back(std::move(line));
+            ++stats.keys;
+        }
+        flushChunk();
+        return runs;
     }
 
-    void mergeSortLCP(std::vector<std::string>& arr, std::size_t left, std::size_t right) {
-        if (right - left <= 1) return;
-        std::size_t mid = (left + right) / 2;
-        mergeSortLCP(arr, left, mid);
-        mergeSortLCP(arr, mid, right);
+    template<typename Sink>
+    void merge(const std::vector<std::filesystem::path>& runs, Stats& stats, Sink sink) {
+        std::vector<RunReader> readers;
+        readers.reserve(runs.size());
+        for (auto& p : runs) readers.emplace_back(p, options.bufferSize);
+        lcpMerge(std::move(readers), sink, stats.comps);
+    }
+
+    std::filesystem::path tempPath() {
+        if (tag.empty()) tag = uniqueTag();
+        temps.push_back(options.tempDir / ("extsort-" + tag + "-" + std::to_string(temps.size()) + ".run"));
+        return temps.back();
+    }
+
+    void release(const std::filesystem::path& p) {
+        std::error_code ec;
+        std::filesystem::remove(p, ec);
+    }
+};
+
+// Two-sided 95% quantile of Student's t distribution with df degrees of freedom.
+inline double studentT975(std::size_t df) {
+    static const double table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (df == 0) return INFINITY;
+    return df <= 30 ? table[df - 1] : 1.96 + 2.4 / df;
+}
 
-        std::vector<std::string> temp;
-        temp.reserve(right - left);
+inline TimingStats summarizeTimes(std::vector<double> ns) {
+    TimingStats st;
+    st.samples = ns.size();
+    if (ns.empty()) return st;
+    std::sort(ns.begin(), ns.end());
+    std::size_t n = ns.size();
+    st.min = ns.front();
+    st.median = n % 2 ? ns[n / 2] : (ns[n / 2 - 1] + ns[n / 2]) / 2;
+    st.p95 = ns[(std::size_t)std::ceil(0.95 * n) - 1];
+    st.mean = std::accumulate(ns.begin(), ns.end(), 0.0) / n;
+    double sq = 0;
+    for (double x : ns) sq += (x - st.mean) * (x - st.mean);
+    st.stddev = n > 1 ? std::sqrt(sq / (n - 1)) : 0;
+    return st;
+}
 
-        size_t i = left, j = mid;
+// Repetition policy of averageRun. The first warmup runs are discarded. After
+// minRuns measured runs it stops as soon as the 95% confidence interval of the mean
+// is within relativeError of the mean, and in any case after maxRuns runs or once
+// the measured runs have taken timeBudget.
+struct RunPolicy {
+    int warmup = 1;
+    int minRuns = 5;
+    int maxRuns = 100;
+    double relativeError = 0.02;
+    std::chrono::nanoseconds timeBudget = std::chrono::seconds(2);
+};
 
-        while (i < mid && j < right) {
-            ++comps;
-            if (arr[i] <= arr[j])
-                temp.push_back(arr[i++]);
-            else
-                temp.push_back(arr[j++]);
+// The measured runs, without warmups, are also appended to samples if given.
+template<typename Func>
+SortResult averageRun(Func f, const RunPolicy& policy = {}, std::vector<SortResult>* samples = nullptr) {
+    for (int i = 0; i < policy.warmup; ++i) f();
+    std::vector<SortResult> results;
+    std::vector<double> times;
+    std::chrono::nanoseconds spent{ 0 };
+    while ((int)results.size() < policy.maxRuns) {
+        results.push_back(f());
+        times.push_back((double)results.back().time.count());
+        spent += results.back().time;
+        if ((int)results.size() < policy.minRuns) continue;
+        if (spent >= policy.timeBudget) break;
+        TimingStats st = summarizeTimes(times);
+        double halfWidth = studentT975(st.samples - 1) * st.stddev / std::sqrt((double)st.samples);
+        if (halfWidth <= policy.relativeError * st.mean) break;
+    }
+    if (samples) samples->insert(samples->end(), results.begin(), results.end());
+    std::size_t runs = results.size();
+    OpCounts total;
+    std::size_t maxDepth = 0;
+    std::size_t peakBytes = 0;
+    HardwareCounts hw;
+    hw.valid.fill(true);
+    for (auto& r : results) {
+        for (std::size_t e = 0; e < HardwareCounts::eventCount; ++e) {
+            hw.value[e] += r.hw.value[e];
+            hw.valid[e] = hw.valid[e] && r.hw.valid[e];
         }
-        while (i < mid) temp.push_back(arr[i++]);
-        while (j < right) temp.push_back(arr[j++]);
+        total.chars += r.ops.chars;
+        total.baseChars += r.ops.baseChars;
+        total.compares += r.ops.compares;
+        total.moves += r.ops.moves;
+        total.allocs += r.ops.allocs;
+        total.allocBytes += r.ops.allocBytes;
+        total.baseCases += r.ops.baseCases;
+        maxDepth = std::max(maxDepth, r.ops.maxDepth);
+        peakBytes = std::max(peakBytes, r.peakBytes);
+    }
+    OpCounts avg;
+    avg.chars = total.chars / runs;
+    avg.baseChars = total.baseChars / runs;
+    avg.compares = total.compares / runs;
+    avg.moves = total.moves / runs;
+    avg.allocs = total.allocs / runs;
+    avg.allocBytes = total.allocBytes / runs;
+    avg.maxDepth = maxDepth;
+    avg.baseCases = total.baseCases / runs;
+    for (std::size_t e = 0; e < HardwareCounts::eventCount; ++e)
+        hw.value[e] = hw.valid[e] ? hw.value[e] / runs : 0;
+    TimingStats timing = summarizeTimes(times);
+    return SortResult{ std::chrono::nanoseconds((long long)timing.median), avg, peakBytes, hw, timing };
+}
+
+// "median 12345 ns (min .., mean .., p95 .., sd .., n ..)"
+inline std::string formatTiming(const TimingStats& t) {
+    auto ns = [](double x) { return std::to_string((long long)std::llround(x)); };
+    return "median " + ns(t.median) + " ns (min " + ns(t.min) + ", mean " + ns(t.mean) + ", p95 " + ns(t.p95)
+           + ", sd " + ns(t.stddev) + ", n " + std::to_string(t.samples) + ")";
+}
 
-        std::copy(temp.begin(), temp.end(), arr.begin() + left);
+// Where and how the benchmark was built and run, repeated in every result record.
+// BENCH_FLAGS and BENCH_COMMIT may be defined on the compiler command line; the
+// commit otherwise comes from $BENCH_COMMIT or from git in the working directory.
+struct RunEnvironment {
+    std::string cpu = "unknown";
+    std::string compiler;
+    std::string flags;
+    std::string commit = "unknown";
+    unsigned hardwareThreads = std::thread::hardware_concurrency();
+
+    static RunEnvironment detect() {
+        RunEnvironment env;
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; std::getline(cpuinfo, line);) {
+            if (line.rfind("model name", 0) != 0) continue;
+            std::size_t colon = line.find(':');
+            if (colon != std::string::npos) env.cpu = line.substr(line.find_first_not_of(' ', colon + 1));
+            break;
+        }
+#if defined(__clang__)
+        env.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+        env.compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        env.compiler = "msvc " + std::to_string(_MSC_FULL_VER);
+#endif
+#if defined(BENCH_FLAGS)
+        env.flags = BENCH_FLAGS;
+#else
+#if defined(__OPTIMIZE__)
+        env.flags += "optimized";
+#else
+        env.flags += "unoptimized";
+#endif
+#if defined(NDEBUG)
+        env.flags += " NDEBUG";
+#endif
+#if defined(__AVX512BW__)
+        env.flags += " avx512bw";
+#elif defined(__AVX2__)
+        env.flags += " avx2";
+#endif
+#endif
+#if defined(BENCH_COMMIT)
+        env.commit = BENCH_COMMIT;
+#else
+        if (const char* c = std::getenv("BENCH_COMMIT")) {
+            env.commit = c;
+        } else {
+#if defined(__unix__) || defined(__APPLE__)
+            if (FILE* git = popen("git rev-parse HEAD 2>/dev/null", "r")) {
+                char buf[64] = {};
+                if (std::fgets(buf, sizeof(buf), git) && std::strlen(buf) >= 40) env.commit.assign(buf, 40);
+                pclose(git);
+            }
+#endif
+        }
+#endif
+        return env;
     }
+};
 
-    void ternaryQuickSort(std::vector<std::string>& arr, int lo, int hi) {
-        if (lo >= hi) return;
-        int lt = lo, gt = hi;
-        const std::string& pivot = arr[lo];
-        int i = lo + 1;
-        while (i <= gt) {
-            ++comps;
-            if (arr[i] < pivot) std::swap(arr[lt++], arr[i++]);
-            else if (arr[i] > pivot) std::swap(arr[i], arr[gt--]);
-            else ++i;
+// One measured run of one configuration, as written by ResultsWriter.
+struct BenchRecord {
+    std::string algo;
+    std::string kind;
+    std::size_t size = 0;
+    unsigned seed = 0;
+    std::size_t threads = 1;
+    std::optional<std::size_t> cutoff;  // unset for algorithms without a base-case cutoff
+    std::size_t run = 0;
+    SortResult result;
+};
+
+// Writes BenchRecords as JSON Lines or CSV, one record per line with the run
+// environment in every record; the CSV header is written before the first record.
+// Hardware events that were not captured, and the cutoff of algorithms that have
+// none, are null in JSON and empty in CSV.
+class ResultsWriter {
+public:
+    enum class Format { Jsonl, Csv };
+
+    // Format from the file extension: ".csv" is CSV, anything else JSON Lines.
+    static Format formatFor(const std::filesystem::path& path) {
+        return path.extension() == ".csv" ? Format::Csv : Format::Jsonl;
+    }
+
+    ResultsWriter(std::ostream& out, Format format, RunEnvironment env)
+        : out(out), format(format), env(std::move(env)) {}
+
+    void write(const BenchRecord& r) {
+        const SortResult& res = r.result;
+        const OpCounts& ops = res.ops;
+        std::vector<Field> fields = {
+            text("algo", r.algo), text("kind", r.kind), number("size", r.size), number("seed", r.seed),
+            number("threads", r.threads), r.cutoff ? number("cutoff", *r.cutoff) : Field{ "cutoff", "", Field::Null }, number("run", r.run),
+            number("time_ns", (std::uint64_t)res.time.count()),
+            number("chars", ops.chars), number("base_chars", ops.baseChars), number("compares", ops.compares),
+            number("moves", ops.moves), number("max_depth", ops.maxDepth), number("base_cases", ops.baseCases),
+            number("allocs", ops.allocs), number("alloc_bytes", ops.allocBytes), number("peak_bytes", res.peakBytes)
+        };
+        static const char* hwKeys[HardwareCounts::eventCount] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+        };
+        for (std::size_t e = 0; e < HardwareCounts::eventCount; ++e)
+            fields.push_back(res.hw.valid[e] ? number(hwKeys[e], res.hw.value[e]) : Field{ hwKeys[e], "", Field::Null });
+        fields.push_back(text("cpu", env.cpu));
+        fields.push_back(text("compiler", env.compiler));
+        fields.push_back(text("flags", env.flags));
+        fields.push_back(text("commit", env.commit));
+        fields.push_back(number("hardware_threads", env.hardwareThreads));
+
+        if (format == Format::Jsonl) {
+            out << '{';
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                const Field& f = fields[i];
+                out << (i ? "," : "") << '"' << f.name << "\":";
+                if (f.type == Field::Null) out << "null";
+                else if (f.type == Field::Number) out << f.value;
+                else out << jsonString(f.value);
+            }
+            out << "}\n";
+        } else {
+            if (!headerWritten) {
+                for (std::size_t i = 0; i < fields.size(); ++i) out << (i ? "," : "") << fields[i].name;
+                out << '\n';
+                headerWritten = true;
+            }
+            for (std::size_t i = 0; i < fields.size(); ++i)
+                out << (i ? "," : "") << (fields[i].type == Field::String ? csvString(fields[i].value) : fields[i].value);
+            out << '\n';
         }
-        ternaryQuickSort(arr, lo, lt - 1);
-        ternaryQuickSort(arr, gt + 1, hi);
     }
 
-    static constexpr int R = 74;
-    static constexpr int cutoff = 15;
+private:
+    struct Field {
+        const char* name;
+        std::string value;
+        enum Type { Number, String, Null } type;
+    };
+
+    std::ostream& out;
+    Format format;
+    RunEnvironment env;
+    bool headerWritten = false;
 
-    int charToIndex(char c) {
-        static std::string alpha =
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz"
-            "0123456789"
-            "!@#%:;^&*()-.";
-        auto pos = alpha.find(c);
-        return pos == std::string::npos ? -1 : (int)pos;
+    static Field number(const char* name, std::uint64_t v) { return { name, std::to_string(v), Field::Number }; }
+    static Field text(const char* name, const std::string& v) { return { name, v, Field::String }; }
+
+    static std::string jsonString(const std::string& s) {
+        std::string r = "\"";
+        for (unsigned char c : s) {
+            if (c == '"' || c == '\\') {
+                r += '\\';
+                r += (char)c;
+            } else if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                r += buf;
+            } else {
+                r += (char)c;
+            }
+        }
+        return r + '"';
     }
 
-    int charAt(const std::string& s, std::size_t d) {
-        return d < s.length() ? charToIndex(s[d]) : -1;
+    static std::string csvString(const std::string& s) {
+        if (s.find_first_of(",\"\n\r") == std::string::npos) return s;
+        std::string r = "\"";
+        for (char c : s) {
+            if (c == '"') r += '"';
+            r += c;
+        }
+        return r + '"';
     }
+};
 
-    void msdRadixSort(std::vector<std::string>& arr, std::size_t left, std::size_t right, std::size_t d) {
-        if (right <= left + 1) return;
-        if (right - left <= cutoff) {
-            ternaryQuickSortSuffix(arr, left, right - 1, d);
-            return;
+// A benchmark cell: the measured runs of all seeds are pooled per cell. The cutoff
+// keeps the runs of the cutoff section apart from the default-cutoff cell.
+struct CellKey {
+    std::string algo;
+    std::string kind;
+    std::size_t size = 0;
+    std::size_t threads = 1;
+    std::optional<std::size_t> cutoff;
+
+    bool operator<(const CellKey& o) const {
+        return std::tie(algo, kind, size, threads, cutoff) < std::tie(o.algo, o.kind, o.size, o.threads, o.cutoff);
+    }
+};
+
+using CellTimes = std::map<CellKey, std::vector<double>>;
+
+// Fields of one flat JSON object as written by ResultsWriter; strings are unescaped
+// (\uXXXX only below 0x80), numbers and null are kept as their text.
+inline std::unordered_map<std::string, std::string> parseJsonRecord(const std::string& line) {
+    std::unordered_map<std::string, std::string> fields;
+    std::size_t i = 0;
+    auto fail = [&]() { throw std::invalid_argument("malformed JSON record: " + line); };
+    auto skipSpace = [&]() { while (i < line.size() && std::isspace((unsigned char)line[i])) ++i; };
+    auto parseString = [&]() {
+        if (i >= line.size() || line[i] != '"') fail();
+        std::string r;
+        for (++i; i < line.size() && line[i] != '"'; ++i) {
+            if (line[i] != '\\') {
+                r += line[i];
+                continue;
+            }
+            if (++i >= line.size()) fail();
+            char c = line[i];
+            if (c == 'u') {
+                if (i + 4 >= line.size()) fail();
+                r += (char)std::stoi(line.substr(i + 1, 4), nullptr, 16);
+                i += 4;
+            } else {
+                r += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+            }
         }
-        std::vector<std::size_t> count(R + 2, 0);
-        for (std::size_t i = left; i < right; ++i) {
-            ++count[charAt(arr[i], d) + 2];
-            ++comps;
+        if (i >= line.size()) fail();
+        ++i;
+        return r;
+    };
+    skipSpace();
+    if (i >= line.size() || line[i++] != '{') fail();
+    for (;;) {
+        skipSpace();
+        if (i < line.size() && line[i] == '}') break;
+        std::string key = parseString();
+        skipSpace();
+        if (i >= line.size() || line[i++] != ':') fail();
+        skipSpace();
+        if (i < line.size() && line[i] == '"') {
+            fields[key] = parseString();
+        } else {
+            std::size_t end = line.find_first_of(",}", i);
+            if (end == std::string::npos) fail();
+            std::string v = line.substr(i, end - i);
+            while (!v.empty() && std::isspace((unsigned char)v.back())) v.pop_back();
+            fields[key] = v;
+            i = end;
         }
-        for (int r = 0; r < R + 1; ++r)
-            count[r + 1] += count[r];
-        std::vector<std::string> aux(right - left);
-        for (std::size_t i = left; i < right; ++i)
-            aux[count[charAt(arr[i], d) + 1]++] = std::move(arr[i]);
-        for (std::size_t i = 0; i < aux.size(); ++i)
-            arr[left + i] = std::move(aux[i]);
-        for (int r = 0; r < R; ++r)
-            msdRadixSort(arr, left + count[r], left + count[r + 1], d + 1);
+        skipSpace();
+        if (i < line.size() && line[i] == ',') ++i;
+        else if (i < line.size() && line[i] == '}') break;
+        else fail();
     }
+    return fields;
+}
 
-    void msdRadixSortPure(std::vector<std::string>& arr, std::size_t left, std::size_t right, std::size_t d) {
-        if (right <= left + 1) return;
-        std::vector<std::size_t> count(R + 2, 0);
-        for (std::size_t i = left; i < right; ++i) {
-            ++count[charAt(arr[i], d) + 2];
-            ++comps;
+inline std::vector<std::string> parseCsvLine(const std::string& line) {
+    std::vector<std::string> cells(1);
+    bool quoted = false;
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c != '"') cells.back() += c;
+            else if (i + 1 < line.size() && line[i + 1] == '"') cells.back() += line[++i];
+            else quoted = false;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            cells.emplace_back();
+        } else if (c != '\r') {
+            cells.back() += c;
         }
-        for (int r = 0; r < R + 1; ++r)
-            count[r + 1] += count[r];
-        std::vector<std::string> aux(right - left);
-        for (std::size_t i = left; i < right; ++i)
-            aux[count[charAt(arr[i], d) + 1]++] = std::move(arr[i]);
-        for (std::size_t i = 0; i < aux.size(); ++i)
-            arr[left + i] = std::move(aux[i]);
-        for (int r = 0; r < R; ++r)
-            msdRadixSortPure(arr, left + count[r], left + count[r + 1], d + 1);
     }
+    return cells;
+}
 
-    void ternaryQuickSortSuffix(std::vector<std::string>& arr, int lo, int hi, std::size_t d) {
-        if (lo >= hi) return;
-        int lt = lo, gt = hi;
-        const std::string& pivot = arr[lo];
-        int i = lo + 1;
-        while (i <= gt) {
-            ++comps;
-            if (suffixLess(arr[i], pivot, d)) std::swap(arr[lt++], arr[i++]);
-            else if (suffixLess(pivot, arr[i], d)) std::swap(arr[i], arr[gt--]);
-            else ++i;
+// Reads the per-run times of a results file written by ResultsWriter, in either format.
+inline CellTimes loadResultTimes(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot open " + path.string());
+    bool csv = ResultsWriter::formatFor(path) == ResultsWriter::Format::Csv;
+    std::vector<std::string> header;
+    CellTimes times;
+    for (std::string line; std::getline(in, line);) {
+        if (line.empty() || line == "\r") continue;
+        std::unordered_map<std::string, std::string> f;
+        if (csv) {
+            auto cells = parseCsvLine(line);
+            if (header.empty()) {
+                header = std::move(cells);
+                continue;
+            }
+            for (std::size_t c = 0; c < header.size() && c < cells.size(); ++c) f[header[c]] = cells[c];
+        } else {
+            f = parseJsonRecord(line);
         }
-        ternaryQuickSortSuffix(arr, lo, lt - 1, d);
-        ternaryQuickSortSuffix(arr, gt + 1, hi, d);
+        for (const char* name : { "algo", "kind", "size", "threads", "time_ns" })
+            if (!f.count(name)) throw std::runtime_error(path.string() + ": record without " + name);
+        try {
+            CellKey key{ f["algo"], f["kind"], std::stoull(f["size"]), std::stoull(f["threads"]), std::nullopt };
+            // Absent in files from before the field existed; null or empty without a cutoff.
+            auto cut = f.find("cutoff");
+            if (cut != f.end() && !cut->second.empty() && cut->second != "null") key.cutoff = std::stoull(cut->second);
+            times[key].push_back(std::stod(f["time_ns"]));
+        } catch (const std::logic_error&) {
+            throw std::runtime_error(path.string() + ": bad number in record: " + line);
+        }
+    }
+    return times;
+}
+
+// Upper p quantile of the standard normal distribution, by bisection on erfc.
+inline double normalQuantile(double p) {
+    double lo = 0, hi = 40;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (lo + hi) / 2;
+        if (0.5 * std::erfc(mid / std::sqrt(2.0)) > p) lo = mid;
+        else hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+// Hodges-Lehmann estimate of the shift from sample a to sample b, the median of all
+// differences b[j] - a[i], with the distribution-free confidence interval of the
+// Mann-Whitney test: the k-th smallest and k-th largest difference, where k comes
+// from the normal approximation of the rank sum at quantile z. Ties, which are rare
+// in nanosecond timings, are not corrected for. valid is false when the samples are
+// too small to reach z.
+struct ShiftEstimate {
+    double shift = 0;
+    double low = -INFINITY;
+    double high = INFINITY;
+    bool valid = false;
+};
+
+inline ShiftEstimate rankShift(const std::vector<double>& a, const std::vector<double>& b, double z) {
+    ShiftEstimate r;
+    std::size_t n = a.size() * b.size();
+    if (n == 0) return r;
+    std::vector<double> d;
+    d.reserve(n);
+    for (double x : a)
+        for (double y : b) d.push_back(y - x);
+    auto nth = [&](std::size_t i) {
+        std::nth_element(d.begin(), d.begin() + i, d.end());
+        return d[i];
+    };
+    r.shift = n % 2 ? nth(n / 2) : (nth(n / 2 - 1) + nth(n / 2)) / 2;
+    double k = std::floor(n / 2.0 - z * std::sqrt(n * (a.size() + b.size() + 1) / 12.0));
+    if (k < 1) return r;
+    r.low = nth((std::size_t)k - 1);
+    r.high = nth(n - (std::size_t)k);
+    r.valid = true;
+    return r;
+}
+
+// One cell of a baseline comparison. ratio is the Hodges-Lehmann estimate of current
+// over baseline time, drift the ratio of the other cells measured alongside it (at
+// least 1), and [low, high] the confidence interval of ratio / drift.
+struct CellComparison {
+    CellKey key;
+    TimingStats baseline;
+    TimingStats current;
+    double ratio = 1;
+    double drift = 1;
+    double low = 0;
+    double high = INFINITY;
+    bool remeasured = false;
+    enum Verdict { Unchanged, Faster, Slower, Regression, TooFewSamples } verdict = Unchanged;
+};
+
+// Measures a cell again and returns its new run times, or nothing if it cannot.
+using Remeasure = std::function<std::vector<double>(const CellKey&)>;
+
+// Compares the cells present in both sets on log times, so every change is a ratio.
+// The confidence intervals are Bonferroni-corrected to a familywise 95% level over
+// all compared cells. Times of separate processes drift apart as a whole, and by
+// different amounts over a run, so each cell is judged relative to the median ratio
+// of the other cells of its kind and size, which were measured right before and
+// after it; with fewer than three of those, all other cells count. Drift only
+// excuses a slowdown: a drift below 1 is taken as 1, so a cell that got faster is
+// never a regression because its neighbours got faster still. A cell whose
+// interval lies above 1 + threshold (0.05 is 5%) is a regression, above 1 but not
+// beyond the threshold slower, below 1 faster. A regression is only kept if the
+// cell, measured again by remeasure, is still one: a single cell can land in a short
+// burst of load that its neighbours missed.
+inline std::vector<CellComparison> compareCells(const CellTimes& baseline, const CellTimes& current,
+                                                double threshold, const Remeasure& remeasure = nullptr) {
+    auto logs = [](const std::vector<double>& ns) {
+        std::vector<double> r;
+        for (double x : ns) r.push_back(std::log(std::max(x, 1.0)));
+        return r;
+    };
+    std::vector<CellComparison> out;
+    std::vector<std::vector<double>> baseLogs;
+    std::vector<ShiftEstimate> shifts;
+    for (const auto& [key, now] : current) {
+        auto it = baseline.find(key);
+        if (it == baseline.end() || it->second.empty() || now.empty()) continue;
+        CellComparison c;
+        c.key = key;
+        c.baseline = summarizeTimes(it->second);
+        c.current = summarizeTimes(now);
+        out.push_back(c);
+        baseLogs.push_back(logs(it->second));
     }
+    double z = normalQuantile(0.05 / (2 * std::max<std::size_t>(out.size(), 1)));
+    for (std::size_t i = 0; i < out.size(); ++i)
+        shifts.push_back(rankShift(baseLogs[i], logs(current.at(out[i].key)), z));
 
-    bool suffixLess(const std::string& a, const std::string& b, std::size_t d) {
-        size_t i = d;
-        while (i < a.size() && i < b.size()) {
-            ++comps;
-            if (a[i] < b[i]) return true;
-            if (a[i] > b[i]) return false;
-            ++i;
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        return v.empty() ? 0 : v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+    };
+    auto judge = [&](CellComparison& c, const ShiftEstimate& s, double drift) {
+        c.ratio = std::exp(s.shift);
+        c.drift = std::exp(drift);
+        c.low = std::exp(s.low - drift);
+        c.high = std::exp(s.high - drift);
+        if (!s.valid) c.verdict = CellComparison::TooFewSamples;
+        else if (c.low > 1 + threshold) c.verdict = CellComparison::Regression;
+        else if (c.low > 1) c.verdict = CellComparison::Slower;
+        else if (c.high < 1) c.verdict = CellComparison::Faster;
+        else c.verdict = CellComparison::Unchanged;
+    };
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        std::vector<double> group, all;
+        for (std::size_t j = 0; j < out.size(); ++j) {
+            if (j == i) continue;
+            all.push_back(shifts[j].shift);
+            if (out[j].key.kind == out[i].key.kind && out[j].key.size == out[i].key.size)
+                group.push_back(shifts[j].shift);
         }
-        ++comps;
-        return a.size() < b.size();
+        double drift = std::max(0.0, median(group.size() >= 3 ? group : all));
+        judge(out[i], shifts[i], drift);
+        if (out[i].verdict != CellComparison::Regression || !remeasure) continue;
+        auto again = remeasure(out[i].key);
+        if (again.empty()) continue;
+        out[i].current = summarizeTimes(again);
+        out[i].remeasured = true;
+        judge(out[i], rankShift(baseLogs[i], logs(again), z), drift);
     }
+    return out;
+}
+
+struct AlgoInfo {
+    const char* id;
+    const char* name;
+    SortAlgo algo;
 };
 
-template<typename Func>
-SortResult averageRun(Func f, int runs = 5) {
-    std::vector<SortResult> results;
-    for (int i = 0; i < runs; ++i) {
-        results.push_back(f());
+const AlgoInfo algoTable[] = {
+    { "quick", "QuickSort", SortAlgo::StdQuick },
+    { "merge-lcp", "MergeSort with LCP", SortAlgo::StdMergeLCP },
+    { "ternary", "Ternary QuickSort", SortAlgo::TernaryQuick },
+    { "msd", "MSD Radix Sort with cutoff", SortAlgo::MsdRadix },
+    { "msd-pure", "MSD Radix Sort pure", SortAlgo::MsdRadixPure },
+    { "multikey", "Multikey QuickSort", SortAlgo::MultikeyQuick },
+    { "msd-bytes", "MSD Radix Sort full byte", SortAlgo::MsdRadixBytes },
+    { "american-flag", "American Flag Sort", SortAlgo::AmericanFlag },
+    { "msd-cached", "MSD Radix Sort prefix cached", SortAlgo::MsdRadixCached },
+    { "multikey-cached", "Multikey QuickSort prefix cached", SortAlgo::MultikeyQuickCached },
+    { "msd-parallel", "MSD Radix Sort parallel", SortAlgo::MsdRadixParallel },
+    { "merge-lcp-parallel", "MergeSort with LCP parallel", SortAlgo::MergeLCPParallel },
+    { "sample", "String Sample Sort", SortAlgo::SampleSort },
+    { "sample-parallel", "String Sample Sort parallel", SortAlgo::SampleSortParallel },
+    { "burst", "Burstsort", SortAlgo::Burstsort }
+};
+
+struct KindInfo {
+    const char* id;
+    const char* name;
+    StringGenerator::Kind kind;
+};
+
+const KindInfo kindTable[] = {
+    { "random", "Random", StringGenerator::Kind::Random },
+    { "reverse", "Reverse sorted", StringGenerator::Kind::Reverse },
+    { "almost-sorted", "Almost sorted", StringGenerator::Kind::AlmostSorted },
+    { "shared-prefix", "Shared prefix", StringGenerator::Kind::SharedPrefix }
+};
+
+const char* const sectionNames[] = { "scaling", "instrumentation", "cutoff", "kernels", "merge", "external" };
+
+// Settings of one benchmark invocation, from the profile and the command line.
+struct BenchConfig {
+    std::vector<const AlgoInfo*> algos;
+    std::vector<const KindInfo*> kinds;
+    std::vector<std::size_t> sizes;
+    std::vector<unsigned> seeds = { 42 };
+    std::vector<std::size_t> threads;       // for the parallel algorithms; 0 is one per hardware thread
+    std::vector<std::filesystem::path> inputs;
+    std::vector<std::string> sections;
+    std::size_t sectionSize = 3000;         // array size of the sections after the main table
+    RunPolicy policy;
+    std::string output;
+    std::string baseline;
+    double threshold = 0.05;
+    std::filesystem::path sortInput;        // --external-sort: sort this file instead of benchmarking
+    const AlgoInfo* sortAlgo = nullptr;     // its run sort when --algo was given
+    std::filesystem::path sortOutput;
+    std::size_t memoryLimit = 0;            // 0 keeps the ExternalSorter default (demo: 16 KiB)
+    std::filesystem::path tempDir;
+
+    bool runs(const std::string& section) const {
+        return std::find(sections.begin(), sections.end(), section) != sections.end();
     }
-    long long totalTime = 0;
-    long long totalComps = 0;
-    for (auto& r : results) {
-        totalTime += r.time.count();
-        totalComps += r.comps;
+};
+
+inline const char* usageText =
+    "Usage: bench [options]\n"
+    "  --profile quick|full     quick: sizes 100,1000,3000, at most 10 runs, no extra sections;\n"
+    "                           full (default): sizes 100:3000:100 and every section\n"
+    "  --algo LIST              algorithm ids, see --list (default: all)\n"
+    "  --kind LIST              random, reverse, almost-sorted, shared-prefix (default: all)\n"
+    "  --sizes LIST             sizes or ranges FROM:TO:STEP, where STEP xF is geometric (100:100000:x10)\n"
+    "  --seed LIST              generator seeds (default: 42)\n"
+    "  --section-size N         array size of the sections after the main table (default: 3000)\n"
+    "  --threads LIST           thread counts for the parallel algorithms; 0 is one per hardware thread\n"
+    "  --input FILE             also sort the lines of FILE, once per algorithm; repeatable. msd and\n"
+    "                           msd-pure only know letters, digits and !@#%:;^&*()-. and treat any other\n"
+    "                           byte (space, / _ ? = + , ~ $ and so on) as the end of the key; results\n"
+    "                           in the wrong order are reported and not recorded\n"
+    "  --reps N                 exactly N measured runs per case\n"
+    "  --warmup N               discarded runs before measuring (default: 1)\n"
+    "  --min-reps N, --max-reps N, --rel-error E, --time-budget MS\n"
+    "                           adaptive repetition limits, see RunPolicy\n"
+    "  --sections LIST          scaling, instrumentation, cutoff, kernels, merge, external, none, all\n"
+    "  --output FILE            write every measured run to FILE (.csv, otherwise JSON Lines)\n"
+    "  --external-sort FILE     sort the lines of FILE with the external sorter and exit; --algo (one id,\n"
+    "                           default msd-bytes) sorts the runs, with the first --threads value\n"
+    "  --sorted-output FILE     where --external-sort writes (default: FILE.sorted)\n"
+    "  --memory-limit BYTES     memory for the external sort runs; k, m and g suffixes allowed\n"
+    "  --temp-dir DIR           directory for external sort runs (default: the system temp dir)\n"
+    "  --baseline FILE          compare against the runs of an earlier --output file; exit with\n"
+    "                           status 3 if a cell got significantly slower beyond the threshold,\n"
+    "                           relative to the cells measured alongside it and again on a re-run\n"
+    "  --threshold PCT          slowdown tolerated by --baseline, in percent (default: 5)\n"
+    "  --list                   print the algorithm and kind ids\n"
+    "  --help\n";
+
+inline std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> items;
+    std::size_t from = 0;
+    for (;;) {
+        std::size_t comma = s.find(',', from);
+        std::string item = s.substr(from, comma == std::string::npos ? std::string::npos : comma - from);
+        if (!item.empty()) items.push_back(item);
+        if (comma == std::string::npos) return items;
+        from = comma + 1;
+    }
+}
+
+inline std::size_t parseCount(const std::string& s) {
+    std::size_t pos = 0;
+    unsigned long long v = 0;
+    try {
+        v = std::stoull(s, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
     }
-    return SortResult{ std::chrono::milliseconds(totalTime / runs), static_cast<std::size_t>(totalComps / runs) };
+    if (pos == 0 || pos != s.size() || s[0] == '-') throw std::invalid_argument("not a count: " + s);
+    return (std::size_t)v;
 }
 
-int main() {
-    StringGenerator gen(42);
-    StringSortTester tester;
+// "65536", "64k", "256m" or "2g".
+inline std::size_t parseBytes(const std::string& s) {
+    if (s.empty()) throw std::invalid_argument("not a byte count: " + s);
+    std::size_t shift = 0;
+    switch (std::tolower((unsigned char)s.back())) {
+    case 'k': shift = 10; break;
+    case 'm': shift = 20; break;
+    case 'g': shift = 30; break;
+    }
+    std::size_t n = parseCount(shift ? s.substr(0, s.size() - 1) : s);
+    if (n > (SIZE_MAX >> shift)) throw std::invalid_argument("byte count too large: " + s);
+    return n << shift;
+}
 
-    const std::vector<StringGenerator::Kind> kinds = {
-        StringGenerator::Kind::Random,
-        StringGenerator::Kind::Reverse,
-        StringGenerator::Kind::AlmostSorted
-    };
+inline double parseReal(const std::string& s) {
+    std::size_t pos = 0;
+    double v = 0;
+    try {
+        v = std::stod(s, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != s.size() || !(v > 0)) throw std::invalid_argument("not a positive number: " + s);
+    return v;
+}
+
+// "100,1000", "100:3000:100" or "100:100000:x10".
+inline std::vector<std::size_t> parseSizes(const std::string& s) {
+    std::vector<std::size_t> sizes;
+    for (const auto& item : splitList(s)) {
+        std::size_t c1 = item.find(':');
+        if (c1 == std::string::npos) {
+            sizes.push_back(parseCount(item));
+            continue;
+        }
+        std::size_t c2 = item.find(':', c1 + 1);
+        if (c2 == std::string::npos) throw std::invalid_argument("range needs FROM:TO:STEP: " + item);
+        std::size_t from = parseCount(item.substr(0, c1));
+        std::size_t to = parseCount(item.substr(c1 + 1, c2 - c1 - 1));
+        std::string step = item.substr(c2 + 1);
+        if (from == 0) throw std::invalid_argument("range must start above 0: " + item);
+        if (!step.empty() && step[0] == 'x') {
+            double factor = parseReal(step.substr(1));
+            if (factor <= 1) throw std::invalid_argument("geometric step must exceed 1: " + item);
+            for (double n = (double)from; n <= (double)to; n *= factor) {
+                std::size_t v = (std::size_t)std::llround(n);
+                if (sizes.empty() || sizes.back() != v) sizes.push_back(v);
+            }
+        } else {
+            std::size_t inc = parseCount(step);
+            if (inc == 0) throw std::invalid_argument("step must exceed 0: " + item);
+            for (std::size_t n = from; n <= to; n += inc) sizes.push_back(n);
+        }
+    }
+    return sizes;
+}
+
+template<typename Info, std::size_t N>
+std::vector<const Info*> parseIds(const std::string& s, const Info (&table)[N], const char* what) {
+    std::vector<const Info*> picked;
+    for (const auto& id : splitList(s)) {
+        auto it = std::find_if(std::begin(table), std::end(table), [&](const Info& x) { return id == x.id; });
+        if (it == std::end(table)) throw std::invalid_argument(std::string("unknown ") + what + ": " + id);
+        picked.push_back(&*it);
+    }
+    return picked;
+}
+
+inline void applyProfile(BenchConfig& config, const std::string& profile) {
+    config.algos.clear();
+    for (const auto& a : algoTable) config.algos.push_back(&a);
+    config.kinds.clear();
+    for (const auto& k : kindTable) config.kinds.push_back(&k);
+    config.policy = RunPolicy{};
+    if (profile == "quick") {
+        config.sizes = { 100, 1000, 3000 };
+        config.sections.clear();
+        config.policy.minRuns = 3;
+        config.policy.maxRuns = 10;
+        config.policy.timeBudget = std::chrono::milliseconds(200);
+    } else if (profile == "full") {
+        config.sizes = parseSizes("100:3000:100");
+        config.sections.assign(std::begin(sectionNames), std::end(sectionNames));
+    } else {
+        throw std::invalid_argument("unknown profile: " + profile);
+    }
+}
+
+// Parses argv into config. The profile is applied first wherever --profile appears,
+// so that the other options refine it. Returns false if --help or --list was handled.
+inline bool parseArgs(int argc, char** argv, BenchConfig& config) {
+    std::string profile = "full";
+    bool algoGiven = false;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == "--profile") profile = argv[i + 1];
+    applyProfile(config, profile);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string opt = argv[i];
+        if (opt == "--help") {
+            std::cout << usageText;
+            return false;
+        }
+        if (opt == "--list") {
+            for (const auto& a : algoTable) std::cout << "algo " << a.id << "\t" << a.name << "\n";
+            for (const auto& k : kindTable) std::cout << "kind " << k.id << "\t" << k.name << "\n";
+            return false;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("unknown option or missing value: " + opt);
+        std::string val = argv[++i];
+        if (opt == "--profile") {
+        } else if (opt == "--algo") {
+            config.algos = parseIds(val, algoTable, "algorithm");
+            algoGiven = true;
+        } else if (opt == "--kind") {
+            config.kinds = parseIds(val, kindTable, "kind");
+        } else if (opt == "--sizes") {
+            config.sizes = parseSizes(val);
+        } else if (opt == "--section-size") {
+            config.sectionSize = parseCount(val);
+            if (config.sectionSize == 0) throw std::invalid_argument("--section-size must exceed 0");
+        } else if (opt == "--seed") {
+            config.seeds.clear();
+            for (const auto& x : splitList(val)) config.seeds.push_back((unsigned)parseCount(x));
+        } else if (opt == "--threads") {
+            config.threads.clear();
+            for (const auto& x : splitList(val)) config.threads.push_back(parseCount(x));
+        } else if (opt == "--input") {
+            config.inputs.push_back(val);
+        } else if (opt == "--reps") {
+            config.policy.minRuns = config.policy.maxRuns = (int)parseCount(val);
+            config.policy.timeBudget = std::chrono::nanoseconds::max();
+        } else if (opt == "--warmup") {
+            config.policy.warmup = (int)parseCount(val);
+        } else if (opt == "--min-reps") {
+            config.policy.minRuns = (int)parseCount(val);
+        } else if (opt == "--max-reps") {
+            config.policy.maxRuns = (int)parseCount(val);
+        } else if (opt == "--rel-error") {
+            config.policy.relativeError = parseReal(val);
+        } else if (opt == "--time-budget") {
+            config.policy.timeBudget = std::chrono::milliseconds(parseCount(val));
+        } else if (opt == "--sections") {
+            config.sections.clear();
+            for (const auto& x : splitList(val)) {
+                if (x == "all") {
+                    config.sections.assign(std::begin(sectionNames), std::end(sectionNames));
+                } else if (x != "none") {
+                    if (std::find(std::begin(sectionNames), std::end(sectionNames), x) == std::end(sectionNames))
+                        throw std::invalid_argument("unknown section: " + x);
+                    config.sections.push_back(x);
+                }
+            }
+        } else if (opt == "--output") {
+            config.output = val;
+        } else if (opt == "--external-sort") {
+            config.sortInput = val;
+        } else if (opt == "--sorted-output") {
+            config.sortOutput = val;
+        } else if (opt == "--memory-limit") {
+            config.memoryLimit = parseBytes(val);
+            if (config.memoryLimit == 0) throw std::invalid_argument("--memory-limit must exceed 0");
+        } else if (opt == "--temp-dir") {
+            config.tempDir = val;
+        } else if (opt == "--baseline") {
+            config.baseline = val;
+        } else if (opt == "--threshold") {
+            config.threshold = parseReal(val) / 100;
+        } else {
+            throw std::invalid_argument("unknown option: " + opt);
+        }
+    }
+    if (config.policy.maxRuns < 1 || config.policy.minRuns > config.policy.maxRuns)
+        throw std::invalid_argument("need 1 <= --min-reps <= --max-reps");
+    if (config.threads.empty()) config.threads = { 0 };
+    if (!config.sortInput.empty() && algoGiven) {
+        if (config.algos.size() != 1) throw std::invalid_argument("--external-sort takes a single --algo");
+        if (!StringSortTester::sortsAnyBytes(config.algos.front()->algo))
+            throw std::invalid_argument(std::string("--external-sort needs an algorithm that orders every byte, not ")
+                                        + config.algos.front()->id);
+        config.sortAlgo = config.algos.front();
+    }
+    return true;
+}
+
+inline std::vector<std::string> readLines(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot open " + path.string());
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(std::move(line));
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    try {
+        if (!parseArgs(argc, argv, config)) return 0;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << "\n\n" << usageText;
+        return 2;
+    }
 
-    const std::vector<std::string> kindNames = {
-        "Random", "Reverse sorted", "Almost sorted"
+    ExternalSorter::Options extOptions;
+    if (!config.tempDir.empty()) extOptions.tempDir = config.tempDir;
+    if (config.sortAlgo) extOptions.algo = config.sortAlgo->algo;
+    extOptions.threads = config.threads.front();
+    auto printExternalStats = [](const ExternalSorter::Stats& st) {
+        std::cout << "External sort array size " << st.keys << "\tTime: " << st.time.count()
+                  << " ns\tChar comparisons: " << st.comps << "\tRuns: " << st.runs
+                  << "\tMerge passes: " << st.mergePasses << "\tRun bytes: " << st.runBytes << " B\n";
     };
+    if (!config.sortInput.empty()) {
+        if (config.memoryLimit) extOptions.memoryLimit = config.memoryLimit;
+        auto output = config.sortOutput.empty() ? std::filesystem::path(config.sortInput.string() + ".sorted")
+                                                : config.sortOutput;
+        try {
+            printExternalStats(ExternalSorter(extOptions).sort(config.sortInput, output));
+        } catch (const std::exception& e) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    CellTimes baseline, current;
+    if (!config.baseline.empty()) {
+        try {
+            baseline = loadResultTimes(config.baseline);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
-    std::vector<StringSortTester::Algo> algos = {
-        StringSortTester::Algo::StdQuick,
-        StringSortTester::Algo::StdMergeLCP,
-        StringSortTester::Algo::TernaryQuick,
-        StringSortTester::Algo::MsdRadix,
-        StringSortTester::Algo::MsdRadixPure
+    // Timed runs use a tester with counting compiled out and allocation tracking off.
+    // The figures come from two untimed runs per cell: one of the timer with tracking
+    // on for allocations, one of the detailed tester for operation counts.
+    BasicStringSortTester<NoCount> timer;
+    BasicStringSortTester<CountDetailed> tester;
+    timer.setAllocationTracking(false);
+    tester.setAllocationTracking(false);
+    if (!timer.setHardwareCounters(true))
+        std::cout << "Hardware counters unavailable (perf_event_open refused); timing only\n\n";
+
+    std::ofstream resultsFile;
+    std::unique_ptr<ResultsWriter> results;
+    if (!config.output.empty()) {
+        resultsFile.open(config.output);
+        if (!resultsFile) {
+            std::cerr << "Cannot open " << config.output << "\n";
+            return 1;
+        }
+        results = std::make_unique<ResultsWriter>(resultsFile, ResultsWriter::formatFor(config.output),
+                                                  RunEnvironment::detect());
+    }
+    std::vector<SortResult> runs;
+    // When expected is given, the output of the first timed run is compared with it
+    // and a mismatch returns nothing, with no runs kept for recording.
+    auto measure = [&](StringSortTester::Algo algo, const std::vector<std::string>& sample,
+                       const std::vector<std::string>* expected = nullptr) -> std::optional<SortResult> {
+        bool correct = true;
+        auto res = averageRun([&]() {
+            auto arrCopy = sample;
+            auto r = timer.run(algo, arrCopy);
+            if (expected) {
+                correct = arrCopy == *expected;
+                expected = nullptr;
+            }
+            return r;
+        }, config.policy, &runs);
+        if (!correct) {
+            runs.clear();
+            return std::nullopt;
+        }
+        auto arrCopy = sample;
+        timer.setAllocationTracking(true);
+        SortResult allocs = timer.run(algo, arrCopy);
+        timer.setAllocationTracking(false);
+        arrCopy = sample;
+        res.ops = tester.run(algo, arrCopy).ops;
+        res.ops.allocs = allocs.ops.allocs;
+        res.ops.allocBytes = allocs.ops.allocBytes;
+        res.peakBytes = allocs.peakBytes;
+        for (auto& r : runs) {
+            r.ops = res.ops;
+            r.peakBytes = res.peakBytes;
+        }
+        return res;
+    };
+    auto setThreads = [&](std::size_t n) {
+        timer.setThreads(n);
+        tester.setThreads(n);
+    };
+    auto setCutoff = [&](StringSortTester::Algo algo, std::size_t cut) {
+        timer.setCutoff(algo, cut);
+        tester.setCutoff(algo, cut);
+    };
+    // With --baseline, every cell keeps how to measure it again: the algorithm, its
+    // settings and the samples it ran on, shared by the algorithms of a sample.
+    struct Rerun {
+        StringSortTester::Algo algo;
+        std::size_t threads;
+        std::optional<std::size_t> cutoff;
+        std::shared_ptr<const std::vector<std::string>> sample;
+    };
+    std::map<CellKey, std::vector<Rerun>> reruns;
+    std::shared_ptr<const std::vector<std::string>> lastSample;
+    auto record = [&](const std::string& algo, const std::string& kind, std::size_t size, unsigned seed,
+                      StringSortTester::Algo a, const std::vector<std::string>& sample) {
+        std::size_t threads = timer.threadsUsed(a, size);
+        std::optional<std::size_t> cutoff;
+        if (StringSortTester::hasCutoff(a)) cutoff = timer.cutoff(a);
+        if (results) {
+            for (std::size_t r = 0; r < runs.size(); ++r)
+                results->write({ algo, kind, size, seed, threads, cutoff, r, runs[r] });
+        }
+        CellKey key{ algo, kind, size, threads, cutoff };
+        auto& times = current[key];
+        for (const auto& r : runs) times.push_back((double)r.time.count());
+        runs.clear();
+        if (config.baseline.empty()) return;
+        if (!lastSample || *lastSample != sample) lastSample = std::make_shared<const std::vector<std::string>>(sample);
+        reruns[key].push_back({ a, timer.threadCount(), cutoff, lastSample });
     };
+    auto remeasure = [&](const CellKey& key) {
+        std::vector<double> times;
+        for (const auto& r : reruns[key]) {
+            setThreads(r.threads);
+            if (r.cutoff) setCutoff(r.algo, *r.cutoff);
+            std::vector<SortResult> again;
+            averageRun([&]() {
+                auto arrCopy = *r.sample;
+                return timer.run(r.algo, arrCopy);
+            }, config.policy, &again);
+            for (const auto& s : again) times.push_back((double)s.time.count());
+        }
+        return times;
+    };
+
+    // Runs every selected algorithm on sample, each parallel one once per thread count.
+    // Samples read from files are recorded with seed 0.
+    auto benchSample = [&](const std::string& kindName, const std::vector<std::string>& sample, unsigned seed,
+                           bool generated) {
+        auto sorted = sample;
+        auto lcps = tester.mergeSortLCP(sorted);
+        std::cout << kindName << " array size " << sample.size();
+        if (generated && config.seeds.size() > 1) std::cout << " seed " << seed;
+        std::cout << "\tDistinguishing prefix: " << StringSortTester::distinguishingPrefix(sorted, lcps) << "\n";
+
+        for (const AlgoInfo* info : config.algos) {
+            auto algo = info->algo;
+            bool parallel = StringSortTester::isParallel(algo);
+            for (std::size_t threads : parallel ? config.threads : std::vector<std::size_t>{ 0 }) {
+                if (parallel) setThreads(threads);
+                auto measured = measure(algo, sample, &sorted);
+                std::cout << info->name;
+                if (parallel && config.threads.size() > 1) std::cout << " " << timer.threadCount() << " threads";
+                if (!measured) {
+                    std::cout << "\tWrong order, not recorded\n";
+                    continue;
+                }
+                record(info->name, kindName, sample.size(), seed, algo, sample);
 
-    std::vector<std::string> algoNames = {
-        "QuickSort",
-        "MergeSort with LCP",
-        "Ternary QuickSort",
-        "MSD Radix Sort with cutoff",
-        "MSD Radix Sort pure"
+                const auto& res = *measured;
+                const auto& ops = res.ops;
+                std::cout << "\tTime: " << formatTiming(res.timing);
+                for (std::size_t e = 0; e < HardwareCounts::eventCount; ++e)
+                    if (res.hw.valid[e]) std::cout << "\t" << HardwareCounts::names[e] << ": " << res.hw.value[e];
+                std::cout << "\tChars: " << ops.chars
+                          << "\tBase case chars: " << ops.baseChars << "\tKey comparisons: " << ops.compares
+                          << "\tMoves: " << ops.moves << "\tMax depth: " << ops.maxDepth
+                          << "\tBase cases: " << ops.baseCases << "\tAllocations: " << ops.allocs
+                          << "\tAllocated: " << ops.allocBytes << " B\tPeak memory: " << res.peakBytes << " B";
+                if (algo == StringSortTester::Algo::Burstsort) {
+                    const auto& bs = timer.burstStats();
+                    std::cout << "\tTrie nodes: " << bs.nodes << "\tContainers: " << bs.containers
+                              << "\tTrie memory: " << bs.bytes << " B";
+                }
+                std::cout << "\n";
+            }
+        }
+        std::cout << "\n";
     };
 
-    for (size_t n = 100; n <= 3000; n += 100) {
-        for (size_t ki = 0; ki < kinds.size(); ++ki) {
-            auto kind = kinds[ki];
-            const auto& kindName = kindNames[ki];
-            std::cout << kindName << " array size " << n << "\n";
+    StringGenerator gen(config.seeds.front());
+    for (unsigned seed : config.seeds) {
+        if (seed != config.seeds.front()) gen = StringGenerator(seed);
+        for (std::size_t n : config.sizes)
+            for (const KindInfo* kind : config.kinds)
+                benchSample(kind->name, gen.getSample(n, kind->kind), seed, true);
+    }
+    for (const auto& path : config.inputs) {
+        std::vector<std::string> lines;
+        try {
+            lines = readLines(path);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
+        }
+        benchSample(path.filename().string(), lines, 0, false);
+    }
+
+    bool failed = false;    // a section failed; main still runs the rest and the gate
+    const std::size_t scalingSize = config.sectionSize;
+    auto scalingSample = gen.getSample(scalingSize, StringGenerator::Kind::Random);
+    unsigned scalingSeed = config.seeds.back();
+
+    if (config.runs("scaling")) {
+        std::vector<std::size_t> threadCounts = config.threads;
+        if (threadCounts == std::vector<std::size_t>{ 0 }) {
+            threadCounts.clear();
+            for (std::size_t t = 1; t <= std::max(1u, std::thread::hardware_concurrency()); ++t)
+                threadCounts.push_back(t);
+        }
+        std::cout << "Parallel scaling array size " << scalingSize << "\n";
+        for (std::size_t t : threadCounts) {
+            setThreads(t);
+            auto res = *measure(StringSortTester::Algo::MsdRadixParallel, scalingSample);
+            record("MSD Radix Sort parallel", "Random", scalingSize, scalingSeed,
+                   StringSortTester::Algo::MsdRadixParallel, scalingSample);
+            std::cout << "MSD Radix Sort parallel " << timer.threadCount() << " threads\tTime: "
+                      << formatTiming(res.timing) << "\tChars: " << res.ops.chars << "\n";
+        }
+        setThreads(config.threads.front());
+        std::cout << "\n";
+    }
+
+    // Same sorts with counting compiled out, counting characters, and full detail.
+    if (config.runs("instrumentation")) {
+        std::cout << "Instrumentation cost array size " << scalingSize << "\n";
+        StringSortTester charTester;
+        charTester.setAllocationTracking(false);
+        auto timeRuns = [&](auto& t, SortAlgo algo) {
+            return averageRun([&]() {
+                auto arrCopy = scalingSample;
+                return t.run(algo, arrCopy);
+            }, config.policy).time.count();
+        };
+        for (const AlgoInfo* info : config.algos) {
+            std::cout << info->name << "\tNoCount: " << timeRuns(timer, info->algo)
+                      << " ns\tCountChars: " << timeRuns(charTester, info->algo)
+                      << " ns\tCountDetailed: " << timeRuns(tester, info->algo) << " ns\n";
+        }
+        std::cout << "\n";
+    }
 
-            for (size_t ai = 0; ai < algos.size(); ++ai) {
-                auto algo = algos[ai];
-                auto algoName = algoNames[ai];
+    if (config.runs("cutoff")) {
+        std::cout << "Radix cutoff array size " << scalingSize << "\n";
+        for (std::size_t cut : { 0, 4, 8, 15, 32, 64 }) {
+            setCutoff(StringSortTester::Algo::MsdRadix, cut);
+            auto res = *measure(StringSortTester::Algo::MsdRadix, scalingSample);
+            record("MSD Radix Sort with cutoff", "Random", scalingSize, scalingSeed, StringSortTester::Algo::MsdRadix,
+                   scalingSample);
+            std::cout << "MSD Radix Sort cutoff " << cut << "\tTime: " << formatTiming(res.timing) << "\tChars: "
+                      << res.ops.chars << "\tDistribution: " << res.ops.chars - res.ops.baseChars << "\tBase case: "
+                      << res.ops.baseChars << "\tBase cases: " << res.ops.baseCases << "\n";
+        }
+        setCutoff(StringSortTester::Algo::MsdRadix, StringSortTester::defaultCutoff);
+        std::cout << "\n";
+    }
 
-                auto sample = gen.getSample(n, kind);
+    if (config.runs("kernels")) {
+        std::cout << "Mismatch kernels (time per full-length compare)\n";
+        auto kernels = mismatchKernels();
+        for (std::size_t len = 8; len <= 4096; len *= 2) {
+            std::string a(len, 'x'), b = a;
+            b.back() = 'y';
+            std::size_t iters = (std::size_t(1) << 26) / len;
+            std::cout << "Length " << len;
+            for (const auto& k : kernels) {
+                volatile std::size_t sink = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < iters; ++i) sink = sink + k.fn(a.data(), b.data(), len);
+                auto end = std::chrono::steady_clock::now();
+                double ns = std::chrono::duration<double, std::nano>(end - start).count() / iters;
+                std::cout << "\t" << k.name << ": " << ns << " ns";
+            }
+            std::cout << "\n";
+        }
+        std::cout << "\n";
+    }
 
-                auto res = averageRun([&]() {
-                    auto arrCopy = sample;
-                    return tester.run(algo, arrCopy);
-                }, 5);
+    if (config.runs("merge")) {
+        std::cout << "K-way LCP merge array size " << scalingSize << "\n";
+        for (std::size_t k = 2; k <= 64; k *= 2) {
+            std::vector<std::vector<std::string>> shards(k);
+            for (std::size_t i = 0; i < scalingSample.size(); ++i) shards[i % k].push_back(scalingSample[i]);
+            for (auto& shard : shards) std::sort(shard.begin(), shard.end());
+            std::vector<std::string> merged;
+            std::vector<std::size_t> mergedLcps;
+            // The merge moves keys out of its inputs, so each run works on fresh copies.
+            auto res = averageRun([&]() {
+                auto inputs = shards;
+                merged.clear();
+                mergedLcps.clear();
+                OpCounts ops;
+                auto start = std::chrono::steady_clock::now();
+                std::vector<IteratorRunSource<std::vector<std::string>::iterator>> sources;
+                for (auto& shard : inputs) sources.emplace_back(shard.begin(), shard.end(), ops.chars);
+                ops.compares = lcpMerge(std::move(sources), [&](std::string& key, std::size_t h) {
+                    merged.push_back(std::move(key));
+                    mergedLcps.push_back(h);
+                }, ops.chars);
+                auto end = std::chrono::steady_clock::now();
+                return SortResult{ end - start, ops, 0, {}, {} };
+            }, config.policy);
+            std::cout << k << " runs\tTime: " << formatTiming(res.timing)
+                      << "\tChar comparisons: " << res.ops.chars << "\tKey comparisons: " << res.ops.compares
+                      << "\tDistinguishing prefix: "
+                      << StringSortTester::distinguishingPrefix(merged, mergedLcps) << "\n";
 
-                std::cout << algoName << "\tTime: " << res.time.count() << " ms\tChar comparisons: " << res.comps << "\n";
+            // The same shards as newline-delimited text, read through StreamRunSource
+            // the way sorted shard outputs on disk are.
+            std::vector<std::string> texts;
+            for (const auto& shard : shards) {
+                std::string text;
+                for (const auto& s : shard) text.append(s).push_back('\n');
+                texts.push_back(std::move(text));
+            }
+            std::vector<std::string> streamed;
+            auto streamRes = averageRun([&]() {
+                streamed.clear();
+                OpCounts ops;
+                auto start = std::chrono::steady_clock::now();
+                std::vector<std::istringstream> streams;
+                streams.reserve(texts.size());
+                for (const auto& text : texts) streams.emplace_back(text);
+                std::vector<StreamRunSource> sources;
+                for (auto& in : streams) sources.emplace_back(in, ops.chars);
+                ops.compares = lcpMerge(std::move(sources), [&](const std::string& key, std::size_t) {
+                    streamed.push_back(key);
+                }, ops.chars);
+                auto end = std::chrono::steady_clock::now();
+                return SortResult{ end - start, ops, 0, {}, {} };
+            }, config.policy);
+            std::cout << k << " streams\tTime: " << formatTiming(streamRes.timing)
+                      << "\tChar comparisons: " << streamRes.ops.chars
+                      << "\tKey comparisons: " << streamRes.ops.compares;
+            if (streamed != merged) {
+                std::cout << "\tWrong order";
+                failed = true;
             }
             std::cout << "\n";
         }
+        std::cout << "\n";
+    }
+
+    // A small memory limit forces the sample to be split into many runs.
+    if (config.runs("external")) {
+        extOptions.memoryLimit = config.memoryLimit ? config.memoryLimit : 16 << 10;
+        extOptions.maxFanIn = 8;
+        std::string tag = ExternalSorter::uniqueTag();
+        auto extInput = extOptions.tempDir / ("extsort-demo-" + tag + "-input.txt");
+        auto extOutput = extOptions.tempDir / ("extsort-demo-" + tag + "-output.txt");
+        // A failure here is reported but does not skip the baseline comparison.
+        try {
+            std::ofstream out(extInput, std::ios::binary);
+            if (!out) throw std::runtime_error("cannot open " + extInput.string() + " for writing");
+            gen.forEachChunk(StringGenerator::Kind::Random, scalingSize, 1 << 16,
+                             [&](const std::vector<std::string>& chunk) {
+                for (const auto& s : chunk) out << s << '\n';
+            });
+            out.close();
+            if (!out) throw std::runtime_error("write to " + extInput.string() + " failed");
+            printExternalStats(ExternalSorter(extOptions).sort(extInput, extOutput));
+        } catch (const std::exception& e) {
+            std::cerr << "error: external section: " << e.what() << "\n";
+            failed = true;
+        }
+        std::error_code ec;
+        std::filesystem::remove(extInput, ec);
+        std::filesystem::remove(extOutput, ec);
+    }
+
+    if (!config.baseline.empty()) {
+        auto cells = compareCells(baseline, current, config.threshold, remeasure);
+        std::size_t counts[5] = {};
+        std::vector<double> ratios;
+        for (const auto& c : cells) ratios.push_back(c.ratio);
+        std::sort(ratios.begin(), ratios.end());
+        std::cout << "\nBaseline " << config.baseline << "\tThreshold: " << config.threshold * 100 << "%";
+        if (!ratios.empty()) std::cout << "\tMedian ratio of all cells: " << ratios[ratios.size() / 2];
+        std::cout << "\n";
+        for (const auto& c : cells) {
+            ++counts[c.verdict];
+            if (c.verdict == CellComparison::Unchanged && !c.remeasured) continue;
+            static const char* verdicts[] = { "unchanged", "faster", "slower", "REGRESSION", "too few runs" };
+            std::cout << verdicts[c.verdict] << "\t" << c.key.algo << "\t" << c.key.kind << "\tsize " << c.key.size
+                      << "\tthreads " << c.key.threads;
+            if (c.key.cutoff) std::cout << "\tcutoff " << *c.key.cutoff;
+            std::cout << "\tMedian: " << std::llround(c.baseline.median) << " -> "
+                      << std::llround(c.current.median) << " ns\tRatio: " << c.ratio << "\tDrift: " << c.drift;
+            if (c.verdict != CellComparison::TooFewSamples)
+                std::cout << "\tAdjusted: " << c.low << " .. " << c.high;
+            if (c.remeasured) std::cout << "\tremeasured";
+            std::cout << "\n";
+        }
+        std::cout << "Compared " << cells.size() << " of " << current.size() << " cells\tUnchanged: "
+                  << counts[CellComparison::Unchanged] << "\tFaster: " << counts[CellComparison::Faster]
+                  << "\tSlower: " << counts[CellComparison::Slower] << "\tRegressions: "
+                  << counts[CellComparison::Regression] << "\tToo few runs: " << counts[CellComparison::TooFewSamples]
+                  << "\n";
+        if (counts[CellComparison::Regression] > 0) return 3;
     }
-    return 0;
+    return failed ? 1 : 0;
 }